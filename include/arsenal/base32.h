@@ -25,7 +25,7 @@
 namespace arsenal::encode
 {
 
-std::string to_base32(const byte_array& in);
+std::string to_base32(byte_view in);
 byte_array from_base32(const std::string& in);
 
 } // arsenal::encode namespace
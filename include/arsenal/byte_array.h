@@ -8,6 +8,9 @@
 //
 #pragma once
 
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
 #include <vector>
 #include <string>
 #include <utility>
@@ -15,29 +18,88 @@
 #include <boost/tr1/array.hpp>
 #include <boost/asio/buffer.hpp>
 #include <boost/utility/string_ref.hpp>
-#include "hash_combine.h"
+#include "byte_view.h"
+#include "hash_bytes.h"
 
 namespace arsenal
 {
 
+template <size_t N>
+class small_byte_array;
+class mapped_file;
+
 /**
  * Class mimicking Qt's QByteArray behavior using STL containers.
+ *
+ * Copies and slices (left(), mid(), right()) share the underlying storage, so they cost
+ * no allocation and no copying, also when handed over to another thread. The storage is
+ * copied on write: the first mutation through a byte_array whose storage is shared gives
+ * it a private copy of its bytes.
+ *
+ * Like pre-C++11 copy-on-write strings, handing out a mutable pointer, reference or
+ * iterator (data(), operator[], begin(), end(), as()) marks the storage unshareable:
+ * later copies and slices get their own bytes, so writes through that pointer never
+ * show up in them. Use const_data() or a const byte_array to read without giving up
+ * sharing.
+ *
+ * Storage comes from a std::pmr::memory_resource, the default resource unless one is given
+ * at construction, e.g. a per-connection pool or a monotonic_buffer_resource for per-request
+ * scratch buffers. Copies, slices and moves keep the resource of their source, they share
+ * its storage after all. Assignment, also from an rvalue, keeps the resource of the target
+ * like std::pmr containers do, and copies the bytes over when the resources differ.
  */
 class byte_array
 {
-    friend bool operator ==(const byte_array& a, const byte_array& b);
-    friend bool operator !=(const byte_array& a, const byte_array& b);
-    std::string value;
+    struct storage;
+    template <typename Owner>
+    struct adopted;
+
+    std::shared_ptr<storage> storage_; // null until something is stored
+    size_t offset_{0};
+    size_t size_{0};
+    std::pmr::memory_resource* resource_{std::pmr::get_default_resource()};
+
+    // Move our bytes to new storage from our resource with room for capacity bytes.
+    void reallocate(size_t capacity);
+    // Private copy of the bytes, for writing.
+    void detach();
+    // Private copy of the bytes if they may still be written through a pointer handed out.
+    void unshare();
+    // Pointer for writing our own bytes, not handed out to the user.
+    char* writable_data();
+    // Private storage starting at our first byte, with room for at least capacity bytes.
+    storage& own(size_t capacity);
+    // Grow by size uninitialized bytes and return the first of them.
+    char* grow_uninitialized(size_t size);
 
 public:
-    using container = std::string;
-    using iterator = container::iterator;
-    using const_iterator = container::const_iterator;
+    using value_type = char;
+    using iterator = char*;
+    using const_iterator = char const*;
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
 
     byte_array();
     byte_array(byte_array const&);
-    byte_array(std::string const& str) : value(str) {}
+    byte_array(byte_array&& other) noexcept;
+    explicit byte_array(allocator_type alloc);
+    byte_array(byte_array const& other, allocator_type alloc);
+    byte_array(byte_array&& other, allocator_type alloc);
+    byte_array(char const* data, size_t size, allocator_type alloc);
+    byte_array(byte_view const& view, allocator_type alloc)
+        : byte_array(view.data(), view.size(), alloc)
+    {}
+    byte_array(std::string const& str);
     byte_array(std::vector<char> const& v) : byte_array(v.data(), v.size()) {}
+    /**
+     * Take over the buffer of a string or vector without copying the bytes.
+     */
+    byte_array(std::string&& str);
+    byte_array(std::vector<char>&& v);
+    /**
+     * Take over a file mapping. The bytes of a read-only mapping are copied on the first
+     * write even when no other byte_array shares them.
+     */
+    byte_array(mapped_file&& file);
     byte_array(char const* str);
     byte_array(char const* data, size_t size);
     byte_array(std::initializer_list<uint8_t> data);
@@ -47,20 +109,39 @@ public:
     byte_array(boost::asio::mutable_buffer const& buf)
         : byte_array(boost::asio::buffer_cast<char const*>(buf), boost::asio::buffer_size(buf))
     {}
+    byte_array(byte_view const& view) : byte_array(view.data(), view.size()) {}
     explicit byte_array(size_t size) { resize(size); }
+    byte_array(size_t size, allocator_type alloc) : resource_(alloc.resource()) { resize(size); }
+    template <size_t N>
+    byte_array(small_byte_array<N> const& small); // defined in small_byte_array.h
 
     template <typename T, size_t N>
-    byte_array(boost::array<T, N> const& in) : value(in.begin(), in.begin() + N) {}
+    byte_array(boost::array<T, N> const& in) {
+        std::copy(in.begin(), in.end(), grow_uninitialized(N));
+    }
 
     template <typename T, size_t N>
-    byte_array(std::array<T, N> const& in) : value(in.begin(), in.begin() + N) {}
+    byte_array(std::array<T, N> const& in) {
+        std::copy(in.begin(), in.end(), grow_uninitialized(N));
+    }
 
     ~byte_array();
     byte_array& operator = (byte_array const& other);
+    /**
+     * Takes over the storage of other when both use the same memory resource.
+     * May allocate, and throw, when they differ.
+     */
     byte_array& operator = (byte_array&& other);
 
+    void swap(byte_array& other) noexcept;
+
+    /**
+     * Allocator over the memory resource the storage comes from.
+     */
+    allocator_type get_allocator() const { return resource_; }
+
     inline bool is_empty() const { return size() == 0; }
-    inline void clear() { value.clear(); }
+    void clear();
 
     char* data();
     const char* data() const;
@@ -68,7 +149,7 @@ public:
     /**
      * @sa length(), capacity()
      */
-    size_t size() const;
+    inline size_t size() const { return size_; }
     /**
      * @sa size(), capacity()
      */
@@ -76,26 +157,89 @@ public:
         return size();
     }
 
-    inline void resize(size_t size) {
-        value.resize(size);
-    }
+    /**
+     * Number of bytes the array can grow to without reallocating, as long as its storage
+     * is not shared.
+     * @sa size(), reserve()
+     */
+    size_t capacity() const;
+
+    /**
+     * Make room for at least size bytes, gives the array private storage.
+     */
+    void reserve(size_t size);
+
+    /**
+     * Release unused capacity. A slice copies its bytes out, which lets go of the
+     * rest of the storage it shared.
+     */
+    void shrink_to_fit();
+
+    /**
+     * New bytes are zeroed. Shrinking only narrows the range of shared bytes this
+     * array refers to.
+     */
+    void resize(size_t size);
+
+    /**
+     * Like resize(), but leaves new bytes uninitialized, for buffers that are about to be
+     * overwritten by a read.
+     */
+    void resize_uninitialized(size_t size);
 
     char at(int i) const;
     char operator[](int i) const;
     char& operator[](int i);
 
-    inline void append(char c) {
-        value.push_back(c);
-    }
+    void append(char c);
+    void append(char const* data, size_t size);
+    void append(byte_array const& c);
 
-    inline void append(byte_array const& c) {
-        value.insert(value.end(), c.begin(), c.end());
+    /**
+     * Let writer produce up to max_size bytes directly at the end of the array.
+     * writer(char* spare, size_t max_size) returns the number of bytes it wrote,
+     * which becomes the number of bytes appended. Returns that number too.
+     */
+    template <typename Writer>
+    size_t append_from(size_t max_size, Writer&& writer)
+    {
+        char* spare = grow_uninitialized(max_size);
+        size_ -= max_size;
+        size_t produced = std::min<size_t>(writer(spare, max_size), max_size);
+        size_ += produced;
+        return produced;
     }
 
+    /**
+     * Slices share storage with this array.
+     */
     byte_array left(size_t size) const;
     byte_array mid(int pos, size_t size = ~0) const;
     byte_array right(size_t size) const;
 
+    /**
+     * Whether other byte_arrays share the storage of this one.
+     */
+    bool is_shared() const;
+
+    /**
+     * Searches return the offset of the match, or npos, see byte_view.
+     */
+    static constexpr size_t npos = byte_view::npos;
+
+    size_t find(char c, size_t from = 0) const { return byte_view(*this).find(c, from); }
+    size_t find(byte_view needle, size_t from = 0) const
+    {
+        return byte_view(*this).find(needle, from);
+    }
+    size_t find_first_of(byte_view set, size_t from = 0) const
+    {
+        return byte_view(*this).find_first_of(set, from);
+    }
+    size_t count(char c) const { return byte_view(*this).count(c); }
+    bool starts_with(byte_view prefix) const { return byte_view(*this).starts_with(prefix); }
+    bool ends_with(byte_view suffix) const { return byte_view(*this).ends_with(suffix); }
+
     /**
      * Fill entire array to char @a ch.
      * If the size is specified, resizes the array beforehand.
@@ -130,70 +274,66 @@ public:
     // There is no const variant of this function, as it may change the vector.
 
     /**
-     * Unlike Qt's fromRawData current implementation of
-     * wrap does not actually wrap the data, it creates
-     * its own copy. XXX fix it
+     * Like Qt's fromRawData, wrap the data without copying it.
+     * The returned view references the data, converting it to a byte_array makes a copy.
      */
-    static byte_array wrap(const char* data, size_t size);
+    static byte_view wrap(const char* data, size_t size) { return byte_view(data, size); }
 
     inline boost::string_ref
     string_view(size_t start_offset, size_t count = boost::string_ref::npos) const {
-        return boost::string_ref(value).substr(start_offset, count);
+        return boost::string_ref(data(), size()).substr(start_offset, count);
     }
 
-    container& as_vector() { return value; }
-    container const& as_vector() const { return value; }
-    std::string as_string() const { return std::string(value.begin(), value.end()); }
+    std::string as_string() const { return std::string(data(), size()); }
+
+    inline operator byte_view() const { return byte_view(data(), size()); }
 
-    inline iterator begin() { return value.begin(); }
-    inline const_iterator begin() const { return value.begin(); }
-    inline iterator end() { return value.end(); }
-    inline const_iterator end() const { return value.end(); }
+    inline iterator begin() { return data(); }
+    inline const_iterator begin() const { return data(); }
+    inline iterator end() { return data() + size(); }
+    inline const_iterator end() const { return data() + size(); }
 };
 
+
 bool operator ==(const byte_array& a, const byte_array& b);
 bool operator !=(const byte_array& a, const byte_array& b);
 
+// Mixed comparisons compare bytes, without converting either side.
+inline bool operator ==(byte_array const& a, byte_view b) { return byte_view(a) == b; }
+inline bool operator ==(byte_view a, byte_array const& b) { return a == byte_view(b); }
+inline bool operator !=(byte_array const& a, byte_view b) { return !(a == b); }
+inline bool operator !=(byte_view a, byte_array const& b) { return !(a == b); }
+
 std::ostream& operator << (std::ostream& os, const byte_array& a);
 
+inline void swap(byte_array& a, byte_array& b) noexcept { a.swap(b); }
+
 } // arsenal namespace
 
 namespace std {
 
 /**
- * Hash specialization for byte_array
+ * Hash specialization for byte_array, equal to the byte_view hash of the same bytes.
  */
 template<>
-struct hash<arsenal::byte_array> : public std::unary_function<arsenal::byte_array, size_t>
+struct hash<arsenal::byte_array>
 {
     inline size_t operator()(arsenal::byte_array const& a) const noexcept
     {
-        // return std::hash_combine_range(a.begin(), a.end()); -- hopefully in c++1y
-        // VEEERY bad implementation for now. @fixme
-        size_t seed = 0xdeadbeef;
-        for (auto x : a) {
-            stdext::hash_combine(seed, x);
-        }
-        return seed;
+        return arsenal::hash_bytes(a.data(), a.size());
     }
 };
 
-} // std namespace
-
 /**
-// Copy-on-write implementation:
-struct BigArray{
-   BigArray():m_data(new int[10000000]){}
-   int  operator[](size_t i)const{return (*m_data)[i];}
-   int& operator[](size_t i){
-        if(!m_data.unique()){//"detach"
-            shared_ptr<int> _tmp(new int[10000000]);
-            memcpy(_tmp.get(),m_data.get(),10000000);
-            m_data=_tmp;
-        }
-        return (*m_data)[i];
+ * Hash specialization for byte_view
+ */
+template<>
+struct hash<arsenal::byte_view>
+{
+    inline size_t operator()(arsenal::byte_view a) const noexcept
+    {
+        return arsenal::hash_bytes(a.data(), a.size());
     }
-private:
-    shared_ptr<int> m_data;
 };
-*/
+
+} // std namespace
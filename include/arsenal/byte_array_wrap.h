@@ -9,7 +9,7 @@
 #pragma once
 
 #include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/categories.hpp>
 #include <boost/range/iterator_range.hpp>
 #include "byte_array.h"
 
@@ -28,26 +28,49 @@ class byte_array_iwrap
 
 public:
     byte_array_iwrap(byte_array const& data)
-        : in(boost::make_iterator_range(data.as_vector()))
+        : in(boost::make_iterator_range(data.begin(), data.end()))
         , ia(in)
     {}
 
     Archive& archive() { return ia; }
 };
 
+/**
+ * Sink device appending everything written to a byte array or a byte_chain,
+ * a block at a time.
+ */
+template <class Bytes>
+class append_sink
+{
+    Bytes* data_;
+
+public:
+    using char_type = char;
+    using category = boost::iostreams::sink_tag;
+
+    append_sink(Bytes& data) : data_(&data) {}
+
+    std::streamsize write(char const* s, std::streamsize n)
+    {
+        data_->append(s, n);
+        return n;
+    }
+};
+
 /**
  * Wrap byte array in an output wrapping for boost.serialization or msgpack archives.
  * Archive type must accept an ostream as constructor argument.
+ * Bytes may also be a byte_chain, to serialize large messages without reallocations.
  */
-template <class Archive>
+template <class Archive, class Bytes = byte_array>
 class byte_array_owrap
 {
     boost::iostreams::filtering_ostream out;
     Archive oa;
 
 public:
-    byte_array_owrap(byte_array& data)
-        : out(boost::iostreams::back_inserter(data.as_vector()))
+    byte_array_owrap(Bytes& data)
+        : out(append_sink<Bytes>(data))
         , oa(out)
     {}
 
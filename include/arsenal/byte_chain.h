@@ -0,0 +1,149 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <boost/asio/buffer.hpp>
+#include "byte_array.h"
+#include "byte_view.h"
+
+namespace arsenal
+{
+
+/**
+ * Free list of fixed-size memory segments for byte_chains.
+ * Released segments are kept for reuse, up to max_free of them, the rest are freed.
+ * Acquiring and releasing is thread-safe, a chain may be released in another thread.
+ */
+class segment_pool
+{
+    size_t segment_size_;
+    size_t max_free_;
+    std::vector<char*> free_;
+    std::mutex mutex_;
+
+public:
+    explicit segment_pool(size_t segment_size = 4096, size_t max_free = 256);
+    ~segment_pool();
+
+    segment_pool(segment_pool const&) = delete;
+    segment_pool& operator = (segment_pool const&) = delete;
+
+    inline size_t segment_size() const { return segment_size_; }
+
+    char* acquire();
+    void release(char* segment);
+
+    /**
+     * Pool used by byte_chains constructed without one.
+     */
+    static segment_pool& default_pool();
+};
+
+/**
+ * Byte buffer made of a chain of pooled segments, for assembling large messages.
+ *
+ * Appending and prepending fill the room left in the last or the first segment and take
+ * new segments from the pool when it runs out, bytes already in the chain are never moved.
+ * Building a message of n bytes is thus linear in n whatever its final size.
+ * The chain is written out with a gather operation over buffers(), or made contiguous with
+ * coalesce() when something needs all of it in one piece.
+ *
+ * Chains are movable but not copyable, segments belong to exactly one chain.
+ */
+class byte_chain
+{
+    struct piece
+    {
+        char* base;      // start of the segment
+        size_t capacity; // segment size
+        size_t begin;    // bytes in use are [begin, end)
+        size_t end;
+        bool pooled;     // segment comes from the pool, otherwise from new[]
+
+        inline size_t size() const { return end - begin; }
+    };
+
+    segment_pool* pool_;
+    std::deque<piece> pieces_;
+    size_t size_{0};
+
+    piece make_piece(size_t at);
+    piece make_block(size_t capacity);
+    void free_piece(piece const& p);
+
+public:
+    using const_buffers_type = std::vector<boost::asio::const_buffer>;
+
+    byte_chain() : byte_chain(segment_pool::default_pool()) {}
+    explicit byte_chain(segment_pool& pool) : pool_(&pool) {}
+    byte_chain(byte_chain&& other);
+    byte_chain& operator = (byte_chain&& other);
+    ~byte_chain();
+
+    inline bool is_empty() const { return size_ == 0; }
+    inline size_t size() const { return size_; }
+    inline size_t length() const { return size_; }
+
+    /**
+     * Number of segments the bytes are spread over.
+     */
+    inline size_t segments() const { return pieces_.size(); }
+
+    /**
+     * Return all segments to the pool.
+     */
+    void clear();
+
+    void append(char c) { append(&c, 1); }
+    void append(char const* data, size_t size);
+    void append(byte_view data) { append(data.data(), data.size()); }
+
+    /**
+     * Move the segments of another chain to the end of this one, without copying.
+     */
+    void append(byte_chain&& other);
+
+    void prepend(char const* data, size_t size);
+    void prepend(byte_view data) { prepend(data.data(), data.size()); }
+
+    /**
+     * Cut the first n bytes off this chain and return them as a chain of their own.
+     * Only the segment the cut goes through is copied.
+     */
+    byte_chain split(size_t n);
+
+    /**
+     * Drop n bytes from the front or back of the chain.
+     */
+    void trim_front(size_t n);
+    void trim_back(size_t n);
+
+    /**
+     * Make the first n bytes contiguous and return them. Copies only when they span
+     * more than one segment.
+     */
+    byte_view coalesce(size_t n);
+    byte_view coalesce() { return coalesce(size_); }
+
+    /**
+     * Gather list over the segments, valid until the chain is modified.
+     * Models the asio ConstBufferSequence concept.
+     */
+    const_buffers_type buffers() const;
+
+    /**
+     * Copy the bytes out into a byte_array.
+     */
+    byte_array to_byte_array() const;
+};
+
+} // arsenal namespace
@@ -0,0 +1,52 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <cstddef>
+
+namespace arsenal
+{
+
+/**
+ * Returned by the searches below when there is no match.
+ */
+constexpr size_t no_match = ~size_t(0);
+
+/**
+ * Offset of the first byte equal to c, or no_match.
+ */
+size_t find_byte(void const* data, size_t size, char c);
+
+/**
+ * Offset of the first occurrence of needle, or no_match. An empty needle matches at 0.
+ * Short needles are filtered sixteen positions at a time on their first and last bytes
+ * with SSE2, long needles and inputs that make the filter misfire too often go to the
+ * linear two-way search of memmem.
+ */
+size_t find_bytes(void const* data, size_t size, void const* needle, size_t needle_size);
+
+/**
+ * Offset of the first byte that is one of the set_size bytes of set, or no_match.
+ * Classifies sixteen bytes at a time with SSSE3 nibble lookups when the CPU has them,
+ * any set costs the same.
+ */
+size_t find_first_of(void const* data, size_t size, void const* set, size_t set_size);
+
+/**
+ * Number of bytes equal to c.
+ */
+size_t count_byte(void const* data, size_t size, char c);
+
+/**
+ * Compare two blocks of secret data, e.g. MACs or keys, in time that depends only on size
+ * and not on where they differ.
+ */
+bool constant_time_equal(void const* a, void const* b, size_t size);
+
+} // arsenal namespace
@@ -0,0 +1,168 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/asio/buffer.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "byte_search.h"
+
+namespace arsenal
+{
+
+/**
+ * Non-owning read-only view of bytes, the counterpart of byte_array for data that lives
+ * elsewhere, e.g. in a receive buffer. Constructing one costs nothing, the viewed bytes must
+ * outlive it.
+ *
+ * Functions that only read bytes take a byte_view, and byte_arrays convert to it implicitly.
+ */
+class byte_view
+{
+    char const* data_{nullptr};
+    size_t size_{0};
+
+public:
+    using const_iterator = char const*;
+    using iterator = const_iterator;
+
+    static constexpr size_t npos = no_match;
+
+    byte_view() = default;
+    byte_view(char const* data, size_t size) : data_(data), size_(size) {}
+    byte_view(std::string const& str) : data_(str.data()), size_(str.size()) {}
+    byte_view(std::vector<char> const& v) : data_(v.data()), size_(v.size()) {}
+    byte_view(boost::asio::const_buffer const& buf)
+        : data_(boost::asio::buffer_cast<char const*>(buf))
+        , size_(boost::asio::buffer_size(buf))
+    {}
+    byte_view(boost::asio::mutable_buffer const& buf)
+        : data_(boost::asio::buffer_cast<char const*>(buf))
+        , size_(boost::asio::buffer_size(buf))
+    {}
+
+    inline bool is_empty() const { return size_ == 0; }
+
+    inline const char* data() const { return data_; }
+    inline const char* const_data() const { return data_; }
+    inline size_t size() const { return size_; }
+    inline size_t length() const { return size_; }
+
+    char at(size_t i) const
+    {
+        if (i >= size_) {
+            throw std::out_of_range("byte_view::at");
+        }
+        return data_[i];
+    }
+
+    inline char operator[](size_t i) const { return data_[i]; }
+
+    byte_view left(size_t size) const { return byte_view(data_, std::min(size, size_)); }
+
+    byte_view mid(size_t pos, size_t size = ~0) const
+    {
+        pos = std::min(pos, size_);
+        return byte_view(data_ + pos, std::min(size, size_ - pos));
+    }
+
+    byte_view right(size_t size) const
+    {
+        size = std::min(size, size_);
+        return byte_view(data_ + size_ - size, size);
+    }
+
+    /**
+     * Searches return the offset of the match, or npos. They start at offset from.
+     */
+    size_t find(char c, size_t from = 0) const
+    {
+        from = std::min(from, size_);
+        return rebase(from, find_byte(data_ + from, size_ - from, c));
+    }
+
+    size_t find(byte_view needle, size_t from = 0) const
+    {
+        from = std::min(from, size_);
+        return rebase(from, find_bytes(data_ + from, size_ - from, needle.data(), needle.size()));
+    }
+
+    /**
+     * Offset of the first byte that is any of the bytes in set.
+     */
+    size_t find_first_of(byte_view set, size_t from = 0) const
+    {
+        from = std::min(from, size_);
+        return rebase(from,
+                      arsenal::find_first_of(data_ + from, size_ - from, set.data(), set.size()));
+    }
+
+    size_t count(char c) const { return count_byte(data_, size_, c); }
+
+    bool starts_with(byte_view prefix) const
+    {
+        return prefix.size() <= size_ and (prefix.size() == 0
+            or std::memcmp(data_, prefix.data(), prefix.size()) == 0);
+    }
+
+    bool ends_with(byte_view suffix) const
+    {
+        return suffix.size() <= size_ and (suffix.size() == 0
+            or std::memcmp(data_ + size_ - suffix.size(), suffix.data(), suffix.size()) == 0);
+    }
+
+    template <typename T>
+    T const* as() const {
+        return reinterpret_cast<T const*>(data_);
+    }
+
+    inline boost::string_ref
+    string_view(size_t start_offset, size_t count = boost::string_ref::npos) const {
+        return boost::string_ref(data_, size_).substr(start_offset, count);
+    }
+
+    std::string as_string() const { return std::string(data_, size_); }
+    boost::asio::const_buffer as_buffer() const { return boost::asio::const_buffer(data_, size_); }
+
+    inline const_iterator begin() const { return data_; }
+    inline const_iterator end() const { return data_ + size_; }
+
+private:
+    static inline size_t rebase(size_t from, size_t found)
+    {
+        return found == npos ? npos : from + found;
+    }
+};
+
+inline bool operator ==(byte_view a, byte_view b)
+{
+    return a.size() == b.size() and (a.size() == 0 or std::memcmp(a.data(), b.data(), a.size()) == 0);
+}
+
+inline bool operator !=(byte_view a, byte_view b)
+{
+    return !(a == b);
+}
+
+/**
+ * Compare secret data without leaking where it differs through timing.
+ * The sizes are not secret, views of different sizes are unequal straight away.
+ */
+inline bool constant_time_equal(byte_view a, byte_view b)
+{
+    return a.size() == b.size() and constant_time_equal(a.data(), b.data(), a.size());
+}
+
+std::ostream& operator << (std::ostream& os, byte_view a);
+
+} // arsenal namespace
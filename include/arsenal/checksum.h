@@ -0,0 +1,35 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace arsenal
+{
+
+/**
+ * CRC-32C (Castagnoli polynomial, as used by iSCSI, SCTP and ext4).
+ * Pass the result of a previous call as crc to checksum data in pieces.
+ * Uses the SSE4.2 crc32 instruction with PCLMULQDQ stream merging when the CPU has them,
+ * and a slicing-by-8 table otherwise.
+ */
+uint32_t crc32c(void const* data, size_t size, uint32_t crc = 0);
+
+/**
+ * Adler-32 checksum (RFC 1950), continuing from a previous result.
+ */
+uint32_t adler32(void const* data, size_t size, uint32_t adler = 1);
+
+/**
+ * Fletcher-16 checksum over bytes, continuing from a previous result.
+ */
+uint16_t fletcher16(void const* data, size_t size, uint16_t sum = 0);
+
+} // arsenal namespace
@@ -148,6 +148,7 @@ public:
     double unpack_double();
 
     byte_array unpack_blob();
+    void unpack_blob(byte_array& out);
     std::string unpack_string();
 
     size_t unpack_array_header();
@@ -351,7 +352,7 @@ inline void iarchive::load(bool& value)
 template <>
 inline void iarchive::load(byte_array& value)
 {
-    value = unpack_blob();
+    unpack_blob(value);
 }
 
 template <>
@@ -422,6 +423,12 @@ inline void oarchive::save(byte_array const& value)
     pack_blob(value.data(), value.size());
 }
 
+template <>
+inline void oarchive::save(byte_view const& value)
+{
+    pack_blob(value.data(), value.size());
+}
+
 template <>
 inline void oarchive::save(std::vector<char> const& value)
 {
@@ -10,10 +10,21 @@
 
 #include "arsenal/optional_field_specification.hpp"
 #include "arsenal/opaque_endian.h"
+#include "arsenal/byte_array.h"
+#include "arsenal/checksum.h"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <boost/mpl/size.hpp>
 #include <boost/mpl/range_c.hpp>
 #include <boost/mpl/for_each.hpp>
@@ -22,9 +33,15 @@
 #include <boost/fusion/include/define_struct.hpp>
 #include <boost/fusion/include/for_each.hpp>
 #include <boost/fusion/include/is_sequence.hpp>
+#include <boost/fusion/include/size.hpp>
 #include <boost/range/has_range_iterator.hpp>
 #include <boost/utility/string_ref.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/endian/conversion.hpp>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
 
 // #include "arsenal/hexdump.h"//temp DEBUG
 
@@ -41,388 +58,1833 @@ constexpr unsigned int operator"" _bits_shift(unsigned long long bits)
 namespace arsenal::fusionary
 {
 
-/*
-//=================================================================================================
-// Lazy reading
-//=================================================================================================
+struct nothing_t
+{
+    template <typename T>
+    operator T()
+    {
+        return T();
+    } // convert to anything - should actually return empty optional?
+};
+
+// * buffer that runs from current point until the end of asio::buffer
+//   (should be easy - when we see it in types, just consume the rest of the buffer)
+//   sentinel type rest_t to grab until the rest of buffer... must be last in struct
+struct rest_t
+{
+    std::string data;
+
+    void operator=(std::string const& other) { data = other; }
+
+    bool operator==(rest_t const& o) const { return data == o.data; }
+};
 
 template <typename T>
-std::pair<T, boost::asio::const_buffer> read(boost::asio::const_buffer b);
+boost::asio::const_buffer read(T& val, boost::asio::const_buffer b);
 
-struct sizer
+template <typename T>
+size_t encoded_size(boost::asio::const_buffer b);
+
+/**
+ * Field decoded on demand.
+ * Reading a lazy<T> only finds out where the encoded T ends and records its bytes,
+ * get() decodes them. Writing a lazy<T> copies the recorded bytes verbatim, so a
+ * payload can be routed further without ever being decoded.
+ * The recorded bytes reference the original buffer, which must outlive the field.
+ */
+template <class T>
+struct lazy
 {
-    mutable boost::asio::const_buffer buf_;
-    mutable size_t size_;
+    boost::asio::const_buffer buf_;
 
-    explicit sizer(boost::asio::const_buffer buf)
+    lazy() = default;
+
+    explicit lazy(boost::asio::const_buffer buf)
         : buf_(std::move(buf))
-        , size_(0)
-    { }
+    {
+    }
 
-    template <class T>
-    auto operator()(T &) const -> typename std::enable_if<std::is_integral<T>::value>::type
+    T get() const
     {
-        size_ += sizeof(T);
-        buf_ = buf_ + sizeof(T);
+        T val;
+        read(val, buf_);
+        return val;
+    }
+
+    size_t size() const { return boost::asio::buffer_size(buf_); }
+
+    boost::asio::const_buffer data() const { return buf_; }
+
+    bool operator==(lazy const& o) const
+    {
+        return size() == o.size()
+            and std::memcmp(boost::asio::buffer_cast<void const*>(buf_),
+                            boost::asio::buffer_cast<void const*>(o.buf_), size()) == 0;
+    }
+};
+
+/**
+ * Zero-copy counterpart of rest_t, references the remainder of the buffer.
+ * The referenced buffer must outlive the field.
+ */
+struct rest_view
+{
+    boost::asio::const_buffer data;
+
+    size_t size() const { return boost::asio::buffer_size(data); }
+
+    bool operator==(rest_view const& o) const
+    {
+        return size() == o.size()
+            and std::memcmp(boost::asio::buffer_cast<void const*>(data),
+                            boost::asio::buffer_cast<void const*>(o.data), size()) == 0;
+    }
+};
+
+/**
+ * Zero-copy counterpart of std::vector<T> for fixed-size elements.
+ * Has the same uint16_t length prefix, elements are decoded on access.
+ * The referenced buffer must outlive the field.
+ */
+template <class T>
+class span_view
+{
+    char const* data_{nullptr};
+    size_t count_{0};
+
+public:
+    span_view() = default;
+
+    span_view(void const* data, size_t count)
+        : data_(static_cast<char const*>(data))
+        , count_(count)
+    {
+    }
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    boost::asio::const_buffer data() const;
+
+    T operator[](size_t index) const;
+
+    class const_iterator
+    {
+        span_view const* span_;
+        size_t index_;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = T;
+
+        const_iterator(span_view const* span, size_t index)
+            : span_(span)
+            , index_(index)
+        {
+        }
+
+        T operator*() const { return (*span_)[index_]; }
+        const_iterator& operator++()
+        {
+            ++index_;
+            return *this;
+        }
+        bool operator==(const_iterator const& o) const { return index_ == o.index_; }
+        bool operator!=(const_iterator const& o) const { return index_ != o.index_; }
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count_); }
+
+    bool operator==(span_view const& o) const
+    {
+        return boost::asio::buffer_size(data()) == boost::asio::buffer_size(o.data())
+            and std::memcmp(data_, o.data_, boost::asio::buffer_size(data())) == 0;
     }
+};
+
+template <class T>
+using range_c = typename boost::mpl::range_c<int, 0, boost::mpl::size<T>::value>;
+
+//=================================================================================================
+// Exceptions
+//=================================================================================================
+
+/**
+ * Reading or writing a field would run past the end of the buffer.
+ */
+class buffer_overrun : public std::runtime_error
+{
+public:
+    explicit inline buffer_overrun(std::string const& msg)
+        : std::runtime_error("fusionary buffer overrun - " + msg)
+    {}
+};
+
+/**
+ * Bytes on the wire do not form a valid value, e.g. a varint that does not fit its type.
+ */
+class invalid_encoding : public std::runtime_error
+{
+public:
+    explicit inline invalid_encoding(std::string const& msg)
+        : std::runtime_error("fusionary invalid encoding - " + msg)
+    {}
+};
+
+/**
+ * Checksum read from the wire does not match the checksummed bytes.
+ */
+class checksum_mismatch : public std::runtime_error
+{
+public:
+    explicit inline checksum_mismatch(std::string const& msg)
+        : std::runtime_error("fusionary checksum mismatch - " + msg)
+    {}
+};
+
+/**
+ * Value is out of the range its wire encoding can represent.
+ */
+class value_overflow : public std::runtime_error
+{
+public:
+    explicit inline value_overflow(std::string const& msg)
+        : std::runtime_error("fusionary value overflow - " + msg)
+    {}
+};
 
-    // ...
+//=================================================================================================
+// Wire primitives
+//=================================================================================================
+
+/**
+ * Integer field types with explicit wire byte order, e.g. big<uint32_t>.
+ * They are unaligned, so they can be placed at any packet offset.
+ */
+template <typename T>
+using big = boost::endian::endian_arithmetic<boost::endian::order::big, T, 8 * sizeof(T),
+                                             boost::endian::align::no>;
+
+template <typename T>
+using little = boost::endian::endian_arithmetic<boost::endian::order::little, T, 8 * sizeof(T),
+                                                boost::endian::align::no>;
+
+/**
+ * Vector of native integers carried in the given wire byte order, with the usual uint16_t
+ * length prefix. The whole block is copied at once and converted in a single loop, which
+ * compilers vectorize.
+ */
+template <boost::endian::order Order, typename T>
+struct endian_vector : std::vector<T>
+{
+    static_assert(std::is_integral<T>::value, "endian_vector holds native integers");
+    using std::vector<T>::vector;
 };
 
-template<class T>
-size_t get_size(boost::asio::const_buffer buf) {
-    sizer s(std::move(buf));
+template <typename T>
+using big_vector = endian_vector<boost::endian::order::big, T>;
+
+template <typename T>
+using little_vector = endian_vector<boost::endian::order::little, T>;
+
+namespace detail
+{
+
+// Packet offsets are not aligned, so all loads and stores go through memcpy.
+// Compilers turn these into single unaligned mov instructions.
+
+template <typename T>
+inline T load(void const* p)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "can only load trivially copyable types");
     T val;
-    s(val);
-    return s.size_;
+    std::memcpy(&val, p, sizeof(T));
+    return val;
 }
 
-template<class T>
-struct lazy {
-    boost::asio::const_buffer buf_;
+template <typename T>
+inline void store(void* p, T const& val)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "can only store trivially copyable types");
+    std::memcpy(p, &val, sizeof(T));
+}
+
+// Load an integer stored in the given byte order, returning it in native order.
+// With optimization this is a single load followed by bswap (or a movbe).
+
+template <boost::endian::order Order, typename T>
+inline T load_ordered(void const* p)
+{
+    return boost::endian::conditional_reverse<Order, boost::endian::order::native>(load<T>(p));
+}
+
+template <boost::endian::order Order, typename T>
+inline void store_ordered(void* p, T val)
+{
+    store(p, boost::endian::conditional_reverse<boost::endian::order::native, Order>(val));
+}
+
+// Convert a block of integers between the given byte order and native order in place.
+
+template <boost::endian::order Order, typename T>
+inline void convert_block(T* data, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = boost::endian::conditional_reverse<Order, boost::endian::order::native>(data[i]);
+    }
+}
+
+// Types whose object representation is exactly their wire representation.
+// Blocks of them are copied with a single memcpy.
+
+template <typename T, typename Enable = void>
+struct is_bitwise : std::false_type
+{};
+
+template <typename T>
+struct is_bitwise<T, std::enable_if_t<(std::is_integral<T>::value
+                                       and !std::is_same<T, bool>::value)
+                                      or is_endian<T>::value>> : std::true_type
+{};
+
+template <typename T, size_t N>
+struct is_bitwise<std::array<T, N>>
+    : std::integral_constant<bool, is_bitwise<T>::value
+                                       and sizeof(std::array<T, N>) == N * sizeof(T)>
+{};
+
+} // detail namespace
+
+//=================================================================================================
+// Variable-length integers
+//=================================================================================================
+
+/**
+ * Unsigned integer in LEB128 encoding: 7 bits per byte, least significant group first,
+ * high bit set on every byte but the last. Values below 128 take a single byte.
+ */
+template <typename T>
+struct varint
+{
+    static_assert(std::is_unsigned<T>::value, "varint holds unsigned integers, use zigzag<T>");
 
-    lazy(boost::asio::const_buffer const& buf)
-        : buf_(boost::asio::buffer_cast<void const*>(buf),
-               get_size<T>(buf))
+    T value{};
+
+    varint() = default;
+    varint(T v)
+        : value(v)
     {
-        buf = buf + boost::asio::buffer_size(buf_);
     }
 
-    T get() const { return read<T>(buf_); }
+    operator T() const { return value; }
+};
+
+/**
+ * Signed integer in LEB128 encoding after zigzag mapping, so that values of small magnitude
+ * are short whatever their sign: 0, -1, 1, -2 are encoded as 0, 1, 2, 3.
+ */
+template <typename T>
+struct zigzag
+{
+    static_assert(std::is_signed<T>::value, "zigzag holds signed integers, use varint<T>");
+
+    T value{};
+
+    zigzag() = default;
+    zigzag(T v)
+        : value(v)
+    {
+    }
 
-    size_t size() const { return asio::buffer_size(buf_); }
+    operator T() const { return value; }
 };
 
-struct reader
+/**
+ * QUIC variable-length integer (RFC 9000, section 16): the two high bits of the first byte
+ * select a length of 1, 2, 4 or 8 bytes, the remaining bits hold the value in big-endian order.
+ */
+struct quic_varint
 {
-    // lazy
-    template<class T>
-    void operator()(lazy<T> & val) const {
-        val = lazy<T>(buf_);
-        buf_ = buf_ + val.size();
+    static constexpr uint64_t max = (uint64_t(1) << 62) - 1;
+
+    uint64_t value{};
+
+    quic_varint() = default;
+    quic_varint(uint64_t v)
+        : value(v)
+    {
     }
+
+    operator uint64_t() const { return value; }
 };
-*/
 
-struct nothing_t
+/**
+ * String, vector or unordered map with a length prefix of type L instead of the default
+ * uint16_t, e.g. prefixed<varint<uint32_t>, std::string>.
+ */
+template <typename L, typename C>
+struct prefixed : C
 {
-    template <typename T>
-    operator T()
+    using C::C;
+
+    prefixed() = default;
+    prefixed(C c)
+        : C(std::move(c))
     {
-        return T();
-    } // convert to anything - should actually return empty optional?
+    }
 };
 
-// * buffer that runs from current point until the end of asio::buffer
-//   (should be easy - when we see it in types, just consume the rest of the buffer)
-//   sentinel type rest_t to grab until the rest of buffer... must be last in struct
-struct rest_t
+using varint_string = prefixed<varint<uint32_t>, std::string>;
+
+template <typename T>
+using varint_vector = prefixed<varint<uint32_t>, std::vector<T>>;
+
+namespace detail
 {
-    std::string data;
 
-    void operator=(std::string const& other) { data = other; }
+template <typename T>
+struct is_varint : std::false_type
+{};
 
-    bool operator==(rest_t const& o) const { return data == o.data; }
-};
+template <typename T>
+struct is_varint<varint<T>> : std::true_type
+{};
 
-template <class T>
-using range_c = typename boost::mpl::range_c<int, 0, boost::mpl::size<T>::value>;
+template <typename T>
+struct is_varint<zigzag<T>> : std::true_type
+{};
 
-struct reader;
+template <>
+struct is_varint<quic_varint> : std::true_type
+{};
 
-struct read_fields
+// Largest container length a length prefix of type L can carry.
+
+template <typename L>
+struct max_length : std::integral_constant<uint64_t, std::numeric_limits<L>::max()>
+{};
+
+template <typename T>
+struct max_length<varint<T>> : max_length<T>
+{};
+
+template <>
+struct max_length<quic_varint> : std::integral_constant<uint64_t, quic_varint::max>
+{};
+
+constexpr size_t max_leb128_size = 10;
+
+// Number of significant bits in v, counting at least one.
+inline unsigned bit_width(uint64_t v)
 {
-    template <typename T, typename V>
-    struct read_field_visitor
-    {
-        T& output_;
-        V& result_;
-        reader const& read_;
-        uint8_t value_;
-
-        read_field_visitor(T& out, V& result, reader const& r, uint8_t val)
-            : output_(out)
-            , result_(result)
-            , read_(r)
-            , value_(val)
-        {
-        }
+    return 64 - __builtin_clzll(v | 1);
+}
 
-        template <class Idx>
-        void operator()(Idx)
-        {
-            if (Idx::value == value_) {
-                read_(boost::fusion::at<Idx>(output_), &output_);
-                result_ = boost::fusion::at<Idx>(output_);
-            }
-        }
-    };
+inline size_t leb128_size(uint64_t v)
+{
+    return (bit_width(v) + 6) / 7;
+}
 
-    template <typename T, typename V>
-    void operator()(varsize_field_wrapper<T, V>& w, reader const& r, uint8_t value)
-    {
-        // std::cout << "r(varsize field wrapper)" << std::endl;
-        boost::mpl::for_each<range_c<T>>(read_field_visitor<T, V>(w.choice_, w.output_, r, value));
+inline uint64_t zigzag_encode(int64_t v)
+{
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t v)
+{
+    return static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+}
+
+// Encode into out, which must have room for max_leb128_size bytes. Returns the encoded size.
+inline size_t encode_leb128(uint64_t v, uint8_t* out)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = static_cast<uint8_t>(v) | 0x80;
+        v >>= 7;
     }
-};
+    out[n++] = static_cast<uint8_t>(v);
+    return n;
+}
+
+// Pack the low 7 bits of every byte of x together, first byte in the lowest bits.
+inline uint64_t compact_7bit_groups(uint64_t x)
+{
+#if defined(__BMI2__)
+    return _pext_u64(x, 0x7f7f7f7f7f7f7f7full);
+#else
+    x = (x & 0x007f007f007f007full) | ((x & 0x7f007f007f007f00ull) >> 1);
+    x = (x & 0x00003fff00003fffull) | ((x & 0x3fff00003fff0000ull) >> 2);
+    x = (x & 0x000000000fffffffull) | ((x & 0x0fffffff00000000ull) >> 4);
+    return x;
+#endif
+}
+
+// Decode a LEB128 value from the size bytes at p. Returns the number of bytes consumed,
+// or 0 when the value is not terminated within size bytes or does not fit 64 bits.
+//
+// Values up to 8 bytes long are decoded without a loop when 8 bytes are readable:
+// the terminating byte is found by counting trailing zeros of the inverted high bits,
+// then the 7-bit groups are packed together with pext or a few shifts.
+inline size_t decode_leb128(uint8_t const* p, size_t size, uint64_t& value)
+{
+    if (size >= 8) {
+        uint64_t word  = load_ordered<boost::endian::order::little, uint64_t>(p);
+        uint64_t stops = ~word & 0x8080808080808080ull;
+        if (stops) {
+            size_t length = __builtin_ctzll(stops) / 8 + 1;
+            value = compact_7bit_groups(word & (~uint64_t(0) >> (64 - 8 * length)));
+            return length;
+        }
+    }
+    uint64_t result = 0;
+    for (size_t i = 0; i < size and i < max_leb128_size; ++i) {
+        if (i == max_leb128_size - 1 and p[i] > 1) {
+            return 0;
+        }
+        result |= uint64_t(p[i] & 0x7f) << (7 * i);
+        if (!(p[i] & 0x80)) {
+            value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+inline size_t quic_varint_size(uint64_t v)
+{
+    unsigned bits = bit_width(v);
+    return size_t(1) << ((bits > 6) + (bits > 14) + (bits > 30));
+}
+
+// Encode into out, which must have room for 8 bytes. Returns the encoded size.
+inline size_t encode_quic_varint(uint64_t v, uint8_t* out)
+{
+    size_t length = quic_varint_size(v);
+    uint64_t tag  = uint64_t(__builtin_ctzll(length)) << (8 * length - 2);
+    store_ordered<boost::endian::order::big>(out, (tag | v) << (64 - 8 * length));
+    return length;
+}
+
+// Encoded size of the QUIC varint starting with the given byte.
+inline size_t quic_varint_size_from_prefix(uint8_t first)
+{
+    return size_t(1) << (first >> 6);
+}
+
+// Decode a QUIC varint from p, which must have at least 8 readable bytes.
+inline uint64_t decode_quic_varint(uint8_t const* p, size_t length)
+{
+    uint64_t word = load_ordered<boost::endian::order::big, uint64_t>(p);
+    return (word >> (64 - 8 * length)) & (~uint64_t(0) >> (66 - 8 * length));
+}
+
+} // detail namespace
 
 //=================================================================================================
-// Reader
+// Bit fields
 //=================================================================================================
 
-struct reader
+namespace detail
 {
-    mutable boost::asio::const_buffer buf_;
-    // using result_type = void;
 
-    explicit reader(boost::asio::const_buffer b)
-        : buf_(std::move(b))
+template <size_t N>
+using uint_for_bits = std::conditional_t<
+    (N <= 8), uint8_t,
+    std::conditional_t<(N <= 16), uint16_t, std::conditional_t<(N <= 32), uint32_t, uint64_t>>>;
+
+} // detail namespace
+
+/**
+ * Unsigned field of N bits.
+ * Consecutive bit fields of a struct are packed together, first field in the most significant
+ * bits, the way RTP or QUIC headers are drawn. Each run of them must add up to whole bytes,
+ * at most 8, and is loaded and stored as a single big-endian word.
+ * Like field_flag, a bit field can hold the flags of optional and varsize fields.
+ */
+template <size_t N, typename T = detail::uint_for_bits<N>>
+struct bits
+{
+    static_assert(N > 0 and N <= 64, "bit fields are 1 to 64 bits wide");
+    static_assert(std::is_unsigned<T>::value and N <= 8 * sizeof(T), "bit field type too narrow");
+
+    using value_type = T;
+    static constexpr size_t width = N;
+    static constexpr uint64_t mask = ~uint64_t(0) >> (64 - N);
+
+    value_type value{};
+
+    bits() = default;
+    bits(T v)
+        : value(v)
     {
     }
 
-    // Read integral values
+    operator T() const { return value; }
+};
 
-    template <typename T, typename P = void>
-    auto operator()(T& val, P* = nullptr) const ->
-        typename std::enable_if<std::is_integral<T>::value>::type
-    {
-        // std::cout << "r(integral value)" << std::endl;
-        val  = *boost::asio::buffer_cast<T const*>(buf_);
-        buf_ = buf_ + sizeof(T);
+namespace detail
+{
+
+template <typename T>
+struct bit_width_of : std::integral_constant<size_t, 0>
+{};
+
+template <size_t N, typename T>
+struct bit_width_of<bits<N, T>> : std::integral_constant<size_t, N>
+{};
+
+// Runs of consecutive bit fields in a struct, given the widths of all its fields
+// (zero for fields that are not bit fields).
+
+constexpr bool starts_bit_run(size_t const* widths, size_t i)
+{
+    return widths[i] and (i == 0 or !widths[i - 1]);
+}
+
+constexpr size_t bit_run_begin(size_t const* widths, size_t i)
+{
+    while (i > 0 and widths[i - 1]) {
+        --i;
     }
+    return i;
+}
 
-    template <typename T, typename P = void>
-    auto operator()(T& val, P* = nullptr) const ->
-        typename std::enable_if<is_endian<T>::value>::type
-    {
-        // std::cout << "r(integral value)" << std::endl;
-        val  = *boost::asio::buffer_cast<T const*>(buf_);
-        buf_ = buf_ + sizeof(T);
+constexpr size_t bit_run_end(size_t const* widths, size_t n, size_t i)
+{
+    while (i < n and widths[i]) {
+        ++i;
+    }
+    return i;
+}
+
+constexpr size_t bit_run_width(size_t const* widths, size_t n, size_t i)
+{
+    size_t sum = 0;
+    for (size_t end = bit_run_end(widths, n, i); i < end; ++i) {
+        sum += widths[i];
+    }
+    return sum;
+}
+
+constexpr bool bit_runs_valid(size_t const* widths, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        if (starts_bit_run(widths, i)) {
+            size_t width = bit_run_width(widths, n, i);
+            if (width % 8 != 0 or width > 64) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Distance of field i from the least significant end of its run.
+constexpr size_t bit_run_shift(size_t const* widths, size_t n, size_t i)
+{
+    size_t shift = 0;
+    for (++i; i < n and widths[i]; ++i) {
+        shift += widths[i];
+    }
+    return shift;
+}
+
+// Wire size of the field at position i: a bit run is accounted to its first field.
+constexpr size_t member_wire_size(size_t const* widths, size_t n, size_t i, size_t size)
+{
+    if (!widths[i]) {
+        return size;
+    }
+    return starts_bit_run(widths, i) ? bit_run_width(widths, n, i) / 8 : 0;
+}
+
+// Load and store words of 1 to 8 bytes in big-endian order.
+
+template <size_t Bytes>
+inline uint64_t load_big_word(void const* p)
+{
+    uint8_t word[sizeof(uint64_t)] = {};
+    std::memcpy(word + sizeof(word) - Bytes, p, Bytes);
+    return load_ordered<boost::endian::order::big, uint64_t>(word);
+}
+
+template <size_t Bytes>
+inline void store_big_word(void* p, uint64_t val)
+{
+    uint8_t word[sizeof(uint64_t)];
+    store_ordered<boost::endian::order::big>(word, val);
+    std::memcpy(p, word + sizeof(word) - Bytes, Bytes);
+}
+
+} // detail namespace
+
+//=================================================================================================
+// Checksums
+//=================================================================================================
+
+/**
+ * Checksum algorithms for checksummed<T, Sum>.
+ */
+struct crc32c_sum
+{
+    using type = uint32_t;
+    static type compute(void const* data, size_t size) { return crc32c(data, size); }
+};
+
+struct adler32_sum
+{
+    using type = uint32_t;
+    static type compute(void const* data, size_t size) { return adler32(data, size); }
+};
+
+struct fletcher16_sum
+{
+    using type = uint16_t;
+    static type compute(void const* data, size_t size) { return fletcher16(data, size); }
+};
+
+/**
+ * Value followed by a big-endian checksum of its encoding.
+ * The writer computes the checksum right after encoding the value, while its bytes are still
+ * in cache, and the reader verifies it the same way after decoding, throwing
+ * checksum_mismatch. Wrap a whole packet body to frame it with a trailing CRC.
+ */
+template <typename T, typename Sum = crc32c_sum>
+struct checksummed
+{
+    T value{};
+
+    checksummed() = default;
+    checksummed(T v)
+        : value(std::move(v))
+    {
+    }
+};
+
+//=================================================================================================
+// Static wire size
+//=================================================================================================
+
+namespace detail
+{
+
+template <typename T, size_t I>
+using field_type_t = typename boost::fusion::result_of::value_at_c<T, I>::type;
+
+template <size_t Offset, size_t... I>
+std::index_sequence<(Offset + I)...> shift_indices(std::index_sequence<I...>);
+
+template <size_t Begin, size_t End>
+using index_range = decltype(shift_indices<Begin>(std::make_index_sequence<End - Begin>()));
+
+// Wire size of a field type.
+// Fixed is true when the encoded size does not depend on the value, then value is that size.
+template <typename T, typename Enable = void>
+struct wire_size
+{
+    static constexpr bool fixed = false;
+    static constexpr size_t value = 0;
+};
+
+template <size_t N>
+struct fixed_wire_size
+{
+    static constexpr bool fixed = true;
+    static constexpr size_t value = N;
+};
+
+template <typename T>
+struct wire_size<T, std::enable_if_t<std::is_integral<T>::value or is_endian<T>::value>>
+    : fixed_wire_size<sizeof(T)>
+{};
+
+template <typename T>
+struct wire_size<T, std::enable_if_t<std::is_enum<T>::value>>
+    : wire_size<std::underlying_type_t<T>>
+{};
+
+template <typename T, size_t N>
+struct wire_size<field_flag<T, N>> : fixed_wire_size<sizeof(T)>
+{};
+
+template <typename T, T v>
+struct wire_size<std::integral_constant<T, v>> : fixed_wire_size<sizeof(T)>
+{};
+
+template <>
+struct wire_size<nothing_t> : fixed_wire_size<0>
+{};
+
+// Bit fields take up no bytes of their own, their enclosing struct accounts for each run.
+template <size_t N, typename T>
+struct wire_size<bits<N, T>> : fixed_wire_size<0>
+{};
+
+template <typename T>
+struct wire_size<lazy<T>> : wire_size<T>
+{};
+
+template <typename T, typename Sum>
+struct wire_size<checksummed<T, Sum>>
+{
+    static constexpr bool fixed = wire_size<T>::fixed;
+    static constexpr size_t value = fixed ? wire_size<T>::value + sizeof(typename Sum::type) : 0;
+};
+
+template <typename T, size_t N>
+struct wire_size<std::array<T, N>>
+{
+    static constexpr bool fixed = wire_size<T>::fixed;
+    static constexpr size_t value = fixed ? N * wire_size<T>::value : 0;
+};
+
+template <typename T>
+struct is_field_flag : std::false_type
+{};
+
+template <typename T, size_t N>
+struct is_field_flag<field_flag<T, N>> : std::true_type
+{};
+
+constexpr size_t leading_true(bool const* flags, size_t n)
+{
+    size_t count = 0;
+    while (count < n and flags[count]) {
+        ++count;
+    }
+    return count;
+}
+
+constexpr size_t sum_first(size_t const* sizes, size_t n)
+{
+    size_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += sizes[i];
+    }
+    return sum;
+}
+
+template <typename T, typename Indices>
+struct sequence_wire_size;
+
+// A sequence is fixed-size when all its fields are. The run of leading fixed-size fields
+// forms its fixed prefix, which can be bounds-checked once as a whole.
+template <typename T, size_t... I>
+struct sequence_wire_size<T, std::index_sequence<I...>>
+{
+    static constexpr size_t fields = sizeof...(I);
+
+    static constexpr size_t field_bits[] = {bit_width_of<field_type_t<T, I>>::value..., 0};
+    static_assert(bit_runs_valid(field_bits, fields),
+                  "consecutive bit fields must add up to 1 to 8 whole bytes");
+
+    static constexpr bool field_fixed[] = {wire_size<field_type_t<T, I>>::fixed..., false};
+    static constexpr size_t field_size[] = {
+        member_wire_size(field_bits, fields, I, wire_size<field_type_t<T, I>>::value)..., 0};
+
+    static constexpr size_t prefix_fields = leading_true(field_fixed, fields);
+    static constexpr size_t prefix_size = sum_first(field_size, prefix_fields);
+
+    static constexpr bool fixed = prefix_fields == fields;
+    static constexpr size_t value = fixed ? prefix_size : 0;
+};
+
+template <typename T>
+struct wire_size<T, std::enable_if_t<boost::fusion::traits::is_sequence<T>::value>>
+    : sequence_wire_size<T, std::make_index_sequence<boost::fusion::result_of::size<T>::value>>
+{};
+
+template <typename T>
+struct checked_static_size
+{
+    static_assert(wire_size<T>::fixed, "type does not have a static wire size");
+    static constexpr size_t value = wire_size<T>::value;
+};
+
+} // detail namespace
+
+/**
+ * True when every value of T occupies the same number of bytes on the wire.
+ */
+template <typename T>
+constexpr bool is_fixed_size = detail::wire_size<T>::fixed;
+
+/**
+ * Number of bytes T occupies on the wire, only defined for fixed-size types.
+ */
+template <typename T>
+constexpr size_t static_size = detail::checked_static_size<T>::value;
+
+/**
+ * Number of bytes in the run of leading fixed-size fields of a fusion sequence.
+ * Equals static_size<T> for fixed-size sequences.
+ */
+template <typename T>
+constexpr size_t fixed_prefix_size = detail::wire_size<T>::prefix_size;
+
+template <class T>
+boost::asio::const_buffer span_view<T>::data() const
+{
+    return boost::asio::const_buffer(data_, count_ * static_size<T>);
+}
+
+template <class T>
+T span_view<T>::operator[](size_t index) const
+{
+    char const* p = data_ + index * static_size<T>;
+    if constexpr (detail::is_bitwise<T>::value) {
+        return detail::load<T>(p);
+    } else {
+        T val;
+        read(val, boost::asio::const_buffer(p, static_size<T>));
+        return val;
+    }
+}
+
+//=================================================================================================
+// Bounds checking policies
+//=================================================================================================
+
+// Check remaining buffer size before every access.
+struct bounds_checked {};
+// Caller guarantees enough space, used for fixed prefixes that were checked as a whole.
+struct bounds_unchecked {};
+
+template <typename Bounds>
+constexpr bool is_checked = std::is_same<Bounds, bounds_checked>::value;
+
+template <typename Bounds>
+struct generic_reader;
+
+using reader = generic_reader<bounds_checked>;
+
+namespace detail
+{
+
+template <typename F, size_t... I>
+inline void dispatch_index(size_t index, F& f, std::index_sequence<I...>)
+{
+    ((index == I ? f(std::integral_constant<size_t, I>()) : void()), ...);
+}
+
+// Call f with std::integral_constant<size_t, index> for the runtime index of an alternative
+// of mapping struct T. Out of range indices call nothing.
+//
+// This unrolls into one inlined comparison per alternative. For 8 and 16 alternatives with
+// random flags that measured faster than a table of function pointers or a binary search,
+// see tools/fusionary_bench.cpp.
+template <typename T, typename F>
+inline void dispatch_alternative(size_t index, F&& f)
+{
+    dispatch_index(index, f, std::make_index_sequence<boost::fusion::result_of::size<T>::value>());
+}
+
+} // detail namespace
+
+struct read_fields
+{
+    template <typename T, typename V, typename R>
+    void operator()(varsize_field_wrapper<T, V>& w, R const& r, uint8_t value)
+    {
+        // std::cout << "r(varsize field wrapper)" << std::endl;
+        detail::dispatch_alternative<T>(value, [&](auto idx) {
+            auto& field = boost::fusion::at_c<decltype(idx)::value>(w.choice_);
+            r(field, &w.choice_);
+            w.output_ = field;
+        });
+    }
+};
+
+//=================================================================================================
+// Reader
+//=================================================================================================
+
+template <typename Bounds>
+struct generic_reader
+{
+    mutable boost::asio::const_buffer buf_;
+    // using result_type = void;
+
+    explicit generic_reader(boost::asio::const_buffer b)
+        : buf_(std::move(b))
+    {
+    }
+
+    // Make sure the next n bytes are readable. No-op for unchecked readers.
+
+    void require(size_t n) const
+    {
+        if constexpr (is_checked<Bounds>) {
+            if (boost::asio::buffer_size(buf_) < n) {
+                throw buffer_overrun("need " + std::to_string(n) + " bytes to read, have "
+                                     + std::to_string(boost::asio::buffer_size(buf_)));
+            }
+        }
+    }
+
+    // Same for count elements of the given size, length prefixes may come from the wire
+    // so the multiplication must not overflow.
+
+    void require(size_t count, size_t element_size) const
+    {
+        if constexpr (is_checked<Bounds>) {
+            if (element_size and count > boost::asio::buffer_size(buf_) / element_size) {
+                throw buffer_overrun("need " + std::to_string(count) + " items of "
+                                     + std::to_string(element_size) + " bytes to read, have "
+                                     + std::to_string(boost::asio::buffer_size(buf_)));
+            }
+        }
+    }
+
+    // Copy raw bytes from the wire.
+
+    void load(void* data, size_t size) const
+    {
+        require(size);
+        std::memcpy(data, boost::asio::buffer_cast<void const*>(buf_), size);
+        buf_ = buf_ + size;
+    }
+
+    // Load a trivially copyable value from the wire.
+
+    template <typename T>
+    T fetch() const
+    {
+        require(sizeof(T));
+        T val = detail::load<T>(boost::asio::buffer_cast<void const*>(buf_));
+        buf_  = buf_ + sizeof(T);
+        return val;
+    }
+
+    // Decode variable-length integers.
+
+    uint64_t fetch_leb128() const
+    {
+        uint64_t val  = 0;
+        size_t size   = boost::asio::buffer_size(buf_);
+        size_t length = detail::decode_leb128(
+            boost::asio::buffer_cast<uint8_t const*>(buf_), size, val);
+        if (length == 0) {
+            if (size < detail::max_leb128_size) {
+                throw buffer_overrun("varint is not terminated within "
+                                     + std::to_string(size) + " bytes");
+            }
+            throw invalid_encoding("varint does not fit 64 bits");
+        }
+        buf_ = buf_ + length;
+        return val;
+    }
+
+    uint64_t fetch_quic_varint() const
+    {
+        require(1);
+        auto p        = boost::asio::buffer_cast<uint8_t const*>(buf_);
+        size_t length = detail::quic_varint_size_from_prefix(p[0]);
+        require(length);
+        uint64_t val = 0;
+        if (boost::asio::buffer_size(buf_) >= sizeof(uint64_t)) {
+            val = detail::decode_quic_varint(p, length);
+        } else {
+            uint8_t padded[sizeof(uint64_t)] = {};
+            std::memcpy(padded, p, length);
+            val = detail::decode_quic_varint(padded, length);
+        }
+        buf_ = buf_ + length;
+        return val;
+    }
+
+    // Read integral values
+    // Plain integers are in host byte order, use big<T> or little<T> for the explicit order.
+
+    template <typename T, typename P = void>
+    auto operator()(T& val, P* = nullptr) const ->
+        typename std::enable_if<std::is_integral<T>::value>::type
+    {
+        // std::cout << "r(integral value)" << std::endl;
+        val = fetch<T>();
+    }
+
+    // Endian types are stored in wire order, the conversion happens when the value is used.
+
+    template <typename T, typename P = void>
+    auto operator()(T& val, P* = nullptr) const ->
+        typename std::enable_if<is_endian<T>::value>::type
+    {
+        // std::cout << "r(endian value)" << std::endl;
+        val = fetch<T>();
+    }
+
+    template <typename T, size_t N, typename P = void>
+    auto operator()(field_flag<T, N>& val, P* = nullptr) const -> void
+    {
+        val.value = fetch<T>();
+    }
+
+    // Read variable-length integers
+
+    template <typename T, typename P = void>
+    void operator()(varint<T>& val, P* = nullptr) const
+    {
+        uint64_t v = fetch_leb128();
+        if (v > std::numeric_limits<T>::max()) {
+            throw invalid_encoding("varint value " + std::to_string(v) + " does not fit "
+                                   + std::to_string(sizeof(T)) + " bytes");
+        }
+        val = static_cast<T>(v);
+    }
+
+    template <typename T, typename P = void>
+    void operator()(zigzag<T>& val, P* = nullptr) const
+    {
+        int64_t v = detail::zigzag_decode(fetch_leb128());
+        if (v < std::numeric_limits<T>::min() or v > std::numeric_limits<T>::max()) {
+            throw invalid_encoding("zigzag value " + std::to_string(v) + " does not fit "
+                                   + std::to_string(sizeof(T)) + " bytes");
+        }
+        val = static_cast<T>(v);
+    }
+
+    template <typename P = void>
+    void operator()(quic_varint& val, P* = nullptr) const
+    {
+        val = fetch_quic_varint();
+    }
+
+    // Read enums
+
+    template <typename T, typename P = void>
+    auto operator()(T& val, P* = nullptr) const ->
+        typename std::enable_if<std::is_enum<T>::value>::type
+    {
+        // std::cout << "r(enum)" << std::endl;
+        typename std::underlying_type<T>::type v;
+        (*this)(v);
+        val = static_cast<T>(v);
+    }
+
+    // Read constant markers
+
+    template <typename T, T v, typename P = void>
+    void operator()(std::integral_constant<T, v>, P* = nullptr) const
+    {
+        // std::cout << "r(integral constant) " << std::showbase << std::hex << v << std::endl;
+        using type = std::integral_constant<T, v>;
+        typename type::value_type val;
+        (*this)(val);
+        if (val != type::value) {
+            throw invalid_encoding("marker " + std::to_string(val) + ", expected "
+                                   + std::to_string(type::value));
+        }
+    }
+
+    // Read longpascal string (uint16_t length)
+
+    template <typename P = void>
+    void operator()(std::string& val, P* = nullptr) const
+    {
+        // std::cout << "r(longpascal string)" << std::endl;
+        uint16_t length = 0;
+        (*this)(length);
+        read_items(val, length);
+    }
+
+    template <typename P = void>
+    void operator()(byte_array& val, P* = nullptr) const
+    {
+        uint16_t length = 0;
+        (*this)(length);
+        read_items(val, length);
+    }
+
+    template <typename P = void>
+    void operator()(boost::string_ref& val, P* = nullptr) const
+    {
+        // std::cout << "r(longpascal string ref)" << std::endl;
+        uint16_t length = 0;
+        (*this)(length);
+        require(length);
+        val  = boost::string_ref(boost::asio::buffer_cast<char const*>(buf_), length);
+        buf_ = buf_ + length;
+    }
+
+    template <typename P = void>
+    void operator()(std::string_view& val, P* = nullptr) const
+    {
+        uint16_t length = 0;
+        (*this)(length);
+        read_items(val, length);
+    }
+
+    // Read vector
+    // Elements with wire-compatible layout are copied in one block.
+
+    template <class T, typename P = void>
+    void operator()(std::vector<T>& vals, P* = nullptr) const
+    {
+        // std::cout << "r(vector)" << std::endl;
+        uint16_t length;
+        (*this)(length);
+        read_items(vals, length);
+    }
+
+    template <boost::endian::order Order, class T, typename P = void>
+    void operator()(endian_vector<Order, T>& vals, P* = nullptr) const
+    {
+        uint16_t length;
+        (*this)(length);
+        size_t start = vals.size();
+        require(length * sizeof(T));
+        vals.resize(start + length);
+        load(vals.data() + start, length * sizeof(T));
+        detail::convert_block<Order>(vals.data() + start, length);
+    }
+
+    // Read vector view, referencing the elements in place
+
+    template <class T, typename P = void>
+    void operator()(span_view<T>& vals, P* = nullptr) const
+    {
+        uint16_t length = 0;
+        (*this)(length);
+        require(length * static_size<T>);
+        vals = span_view<T>(boost::asio::buffer_cast<void const*>(buf_), length);
+        buf_ = buf_ + length * static_size<T>;
+    }
+
+    // Read map
+
+    template <class K, class V, typename P = void>
+    void operator()(std::unordered_map<K, V>& kvs, P* = nullptr) const
+    {
+        // std::cout << "r(map)" << std::endl;
+        uint16_t length;
+        (*this)(length);
+        read_items(kvs, length);
+    }
+
+    // Read containers with a custom length prefix
+
+    template <class L, class C, typename P = void>
+    void operator()(prefixed<L, C>& val, P* = nullptr) const
+    {
+        L length;
+        (*this)(length);
+        read_items(static_cast<C&>(val), static_cast<size_t>(length));
+    }
+
+    // Container contents following the length prefix
+
+    void read_items(std::string& val, size_t length) const
+    {
+        require(length);
+        val  = std::string(boost::asio::buffer_cast<char const*>(buf_), length);
+        buf_ = buf_ + length;
+    }
+
+    // Reuses the capacity and memory resource of val.
+    void read_items(byte_array& val, size_t length) const
+    {
+        require(length);
+        val.clear();
+        val.append(boost::asio::buffer_cast<char const*>(buf_), length);
+        buf_ = buf_ + length;
+    }
+
+    void read_items(std::string_view& val, size_t length) const
+    {
+        require(length);
+        val  = std::string_view(boost::asio::buffer_cast<char const*>(buf_), length);
+        buf_ = buf_ + length;
+    }
+
+    template <class T>
+    void read_items(std::vector<T>& vals, size_t length) const
+    {
+        if constexpr (detail::is_bitwise<T>::value) {
+            size_t start = vals.size();
+            require(length, sizeof(T));
+            vals.resize(start + length);
+            load(vals.data() + start, length * sizeof(T));
+        } else {
+            if constexpr (is_fixed_size<T>) {
+                require(length, static_size<T>);
+            }
+            vals.reserve(vals.size() + std::min(length, boost::asio::buffer_size(buf_)));
+            for (; length; --length) {
+                T val;
+                (*this)(val);
+                vals.emplace_back(std::move(val));
+            }
+        }
+    }
+
+    template <class K, class V>
+    void read_items(std::unordered_map<K, V>& kvs, size_t length) const
+    {
+        for (; length; --length) {
+            K key;
+            (*this)(key);
+            V val;
+            (*this)(val);
+            kvs.emplace(key, val);
+        }
+    }
+
+    // Read varsized field
+    // Must have a parent type otherwise we couldn't read it.
+
+    template <typename Type, typename Index, size_t Mask, size_t Offset, typename P>
+    auto operator()(varsize_field_specification<Type, Index, Mask, Offset>& val, P* parent) const ->
+        typename std::enable_if<boost::fusion::traits::is_sequence<P>::value>::type
+    {
+        // std::cout << "r(varsize field spec)" << std::endl;
+        assert(parent);
+        // We need to extract the flags value out of parent sequence
+        auto vflag = boost::fusion::at<Index>(*parent).value; // do we need bits_type at all?
+        vflag = (vflag >> Offset) & Mask;
+        (*this)(val.value, vflag);
+    }
+
+    // Read the actual varsized field with proper flags.
+    // This is called from the function above and does not need the parent.
+
+    template <typename T, typename V, typename F>
+    void operator()(varsize_field_wrapper<T, V>& val, F flag_value) const
+    {
+        read_fields()(val, *this, flag_value);
+    }
+
+    // Read optional field
+    // Must have a parent type otherwise we couldn't read it.
+
+    template <typename Type, typename Index, size_t N, typename P>
+    auto operator()(optional_field_specification<Type, Index, N>& val, P* parent) const ->
+        typename std::enable_if<boost::fusion::traits::is_sequence<P>::value>::type
+    {
+        // std::cout << "r(optional field spec)" << std::endl;
+        assert(parent);
+        auto flag = boost::fusion::at<Index>(*parent).value; // do we need bits_type at all?
+        if (flag & (1 << N)) {
+            Type v;
+            (*this)(v);
+            val = optional_field_specification<Type, Index, N>(std::move(v));
+        } else {
+            val = boost::none;
+        }
+    }
+
+    // To read custom structs, wrap them into BOOST_FUSION_ADOPT_STRUCT and use this instead
+    // of extra overloads.
+    //
+    // Sequence doesn't usually need parent.
+    // Version with parent for sequence member of a sequence.
+    //
+    // The fixed prefix of the sequence is bounds-checked once and then read without
+    // further checks, only the variable-sized tail is checked field by field.
+    //
+    template <class T, typename P = void>
+    auto operator()(T& val, P* = nullptr) const ->
+        typename std::enable_if<boost::fusion::traits::is_sequence<T>::value>::type
+    {
+        // std::cout << "r(sequence)" << std::endl;
+        using layout = detail::wire_size<T>;
+        constexpr size_t prefix = is_checked<Bounds> ? layout::prefix_fields : 0;
+
+        if constexpr (prefix > 0) {
+            require(layout::prefix_size);
+            generic_reader<bounds_unchecked> fixed(buf_);
+            fixed.read_sequence(val, detail::index_range<0, prefix>());
+            buf_ = fixed.buf_;
+        }
+        read_sequence(val, detail::index_range<prefix, layout::fields>());
+    }
+
+    template <class T, size_t... I>
+    void read_sequence(T& val, std::index_sequence<I...>) const
+    {
+        (read_member<I>(val), ...);
+    }
+
+    // Read a field of a struct.
+    // A run of bit fields is loaded as one word at its first field and split with constant
+    // shifts and masks, the other fields of the run are already done.
+
+    template <size_t I, class T>
+    void read_member(T& val) const
+    {
+        using layout = detail::wire_size<T>;
+        if constexpr (!layout::field_bits[I]) {
+            (*this)(boost::fusion::at_c<I>(val), &val);
+        } else if constexpr (detail::starts_bit_run(layout::field_bits, I)) {
+            constexpr size_t end   = detail::bit_run_end(layout::field_bits, layout::fields, I);
+            constexpr size_t bytes = layout::field_size[I];
+            require(bytes);
+            uint64_t word
+                = detail::load_big_word<bytes>(boost::asio::buffer_cast<void const*>(buf_));
+            unpack_bits(val, word, detail::index_range<I, end>());
+            buf_ = buf_ + bytes;
+        }
+    }
+
+    template <class T, size_t... J>
+    void unpack_bits(T& val, uint64_t word, std::index_sequence<J...>) const
+    {
+        using layout = detail::wire_size<T>;
+        (unpack_bit_field(boost::fusion::at_c<J>(val),
+                          word >> detail::bit_run_shift(layout::field_bits, layout::fields, J)),
+         ...);
+    }
+
+    template <size_t N, typename V>
+    static void unpack_bit_field(bits<N, V>& field, uint64_t word)
+    {
+        field.value = static_cast<V>(word & bits<N, V>::mask);
+    }
+
+    // Read fixed-size array
+
+    template <typename T, size_t N, typename P = void>
+    void operator()(std::array<T, N>& arr, P* = nullptr) const
+    {
+        // std::cout << "r(fixarray)" << std::endl;
+        if constexpr (detail::is_bitwise<T>::value) {
+            load(arr.data(), N * sizeof(T));
+        } else if constexpr (is_checked<Bounds> and is_fixed_size<T>) {
+            require(static_size<std::array<T, N>>);
+            generic_reader<bounds_unchecked> fixed(buf_);
+            fixed(arr);
+            buf_ = fixed.buf_;
+        } else {
+            for (auto& val : arr)
+                (*this)(val);
+        }
+    }
+
+    // Read a value and verify the checksum that follows it
+
+    template <class T, class Sum, typename P = void>
+    void operator()(checksummed<T, Sum>& val, P* = nullptr) const
+    {
+        auto start = boost::asio::buffer_cast<char const*>(buf_);
+        (*this)(val.value);
+        typename Sum::type sum
+            = Sum::compute(start, boost::asio::buffer_cast<char const*>(buf_) - start);
+        big<typename Sum::type> expected;
+        (*this)(expected);
+        if (expected != sum) {
+            throw checksum_mismatch("expected " + std::to_string(expected) + ", computed "
+                                    + std::to_string(sum));
+        }
+    }
+
+    // Read nothing
+
+    template <typename P = void>
+    void operator()(nothing_t&, P* = nullptr) const
+    {
+        // std::cout << "r(nothing)" << std::endl;
+        // Do nothing!
+    }
+
+    // Read lazy field, only recording the extent of its bytes
+
+    template <class T, typename P = void>
+    void operator()(lazy<T>& val, P* = nullptr) const
+    {
+        size_t size = 0;
+        if constexpr (is_fixed_size<T>) {
+            size = static_size<T>;
+            require(size);
+        } else {
+            size = encoded_size<T>(buf_);
+        }
+        val  = lazy<T>(boost::asio::buffer(buf_, size));
+        buf_ = buf_ + size;
+    }
+
+    // Read until the end of the buffer
+    // @todo Simply return buf_ to reduce copying?
+
+    template <typename P = void>
+    void operator()(rest_t& rest, P* = nullptr) const
+    {
+        // std::cout << "Grabbing rest of the packet, size = " << boost::asio::buffer_size(buf_) <<
+        // std::endl;
+        rest.data = std::string(boost::asio::buffer_cast<char const*>(buf_),
+                                boost::asio::buffer_size(buf_));
+        // hexdump(rest.data);
+        buf_ = buf_ + boost::asio::buffer_size(buf_);
+    }
+
+    template <typename P = void>
+    void operator()(rest_view& rest, P* = nullptr) const
+    {
+        rest.data = buf_;
+        buf_      = buf_ + boost::asio::buffer_size(buf_);
+    }
+};
+
+/**
+ * Read a value from the buffer, return the unread remainder.
+ * Throws buffer_overrun if the buffer ends before the value does.
+ */
+template <typename T>
+boost::asio::const_buffer
+read(T& val, boost::asio::const_buffer b)
+{
+    reader r(std::move(b));
+    r(val);
+    // std::cout << "Remaining buffer space after read " << boost::asio::buffer_size(r.buf_) << "
+    // bytes" << std::endl;
+    return r.buf_;
+}
+
+//=================================================================================================
+// Sizer
+//=================================================================================================
+
+/**
+ * Walks over an encoded value to find out how many bytes it occupies, without decoding it.
+ * Fixed-size parts are skipped as a whole, only length prefixes and the flag fields that
+ * decide the presence and size of their sibling fields are actually read.
+ * The values passed in are scratch objects that receive these flags.
+ */
+struct sizer
+{
+    reader read_;
+
+    explicit sizer(boost::asio::const_buffer buf)
+        : read_(std::move(buf))
+    {
+    }
+
+    void skip(size_t n) const
+    {
+        read_.require(n);
+        read_.buf_ = read_.buf_ + n;
     }
 
-    template <typename T, size_t N, typename P = void>
-    auto operator()(field_flag<T, N>& val, P* = nullptr) const -> void
+    template <typename T, typename P = void>
+    auto operator()(T&, P* = nullptr) const -> typename std::enable_if<is_fixed_size<T>>::type
     {
-        val.value = *boost::asio::buffer_cast<T const*>(buf_);
-        buf_      = buf_ + sizeof(T);
+        skip(static_size<T>);
     }
 
-    // Read enums
+    // Variable-length integers have to be decoded to find their end.
 
     template <typename T, typename P = void>
     auto operator()(T& val, P* = nullptr) const ->
-        typename std::enable_if<std::is_enum<T>::value>::type
+        typename std::enable_if<detail::is_varint<T>::value>::type
     {
-        // std::cout << "r(enum)" << std::endl;
-        typename std::underlying_type<T>::type v;
-        (*this)(v);
-        val = static_cast<T>(v);
+        read_(val);
     }
 
-    // Read constant markers
-
-    template <typename T, T v, typename P = void>
-    void operator()(std::integral_constant<T, v>, P* = nullptr) const
+    template <typename P = void>
+    void operator()(std::string&, P* = nullptr) const
     {
-        // std::cout << "r(integral constant) " << std::showbase << std::hex << v << std::endl;
-        using type = std::integral_constant<T, v>;
-        typename type::value_type val;
-        (*this)(val);
-        if (val != type::value) {
-            throw std::exception();
-        }
+        uint16_t length = 0;
+        read_(length);
+        skip(length);
     }
 
-    // Read longpascal string (uint16_t length)
+    template <typename P = void>
+    void operator()(byte_array&, P* = nullptr) const
+    {
+        uint16_t length = 0;
+        read_(length);
+        skip(length);
+    }
 
     template <typename P = void>
-    void operator()(std::string& val, P* = nullptr) const
+    void operator()(boost::string_ref&, P* = nullptr) const
     {
-        // std::cout << "r(longpascal string)" << std::endl;
         uint16_t length = 0;
-        (*this)(length);
-        val  = std::string(boost::asio::buffer_cast<char const*>(buf_), length);
-        buf_ = buf_ + length;
+        read_(length);
+        skip(length);
     }
 
     template <typename P = void>
-    void operator()(boost::string_ref& val, P* = nullptr) const
+    void operator()(std::string_view&, P* = nullptr) const
     {
-        // std::cout << "r(longpascal string ref)" << std::endl;
         uint16_t length = 0;
-        (*this)(length);
-        val  = boost::string_ref(boost::asio::buffer_cast<char const*>(buf_), length);
-        buf_ = buf_ + length;
+        read_(length);
+        skip(length);
     }
 
-    // Read vector
+    template <class T, typename P = void>
+    void operator()(span_view<T>&, P* = nullptr) const
+    {
+        uint16_t length = 0;
+        read_(length);
+        skip(length * static_size<T>);
+    }
 
     template <class T, typename P = void>
     void operator()(std::vector<T>& vals, P* = nullptr) const
     {
-        // std::cout << "r(vector)" << std::endl;
-        uint16_t length;
-        (*this)(length);
-        for (; length; --length) {
-            T val;
-            (*this)(val);
-            vals.emplace_back(std::move(val));
-        }
+        uint16_t length = 0;
+        read_(length);
+        size_items(vals, length);
     }
 
-    // Read map
-
     template <class K, class V, typename P = void>
-    void operator()(std::unordered_map<K, V>& kvs, P* = nullptr)
+    void operator()(std::unordered_map<K, V>& kvs, P* = nullptr) const
+    {
+        uint16_t length = 0;
+        read_(length);
+        size_items(kvs, length);
+    }
+
+    template <class L, class C, typename P = void>
+    void operator()(prefixed<L, C>& val, P* = nullptr) const
+    {
+        L length;
+        read_(length);
+        size_items(static_cast<C&>(val), static_cast<size_t>(length));
+    }
+
+    void size_items(std::string&, size_t length) const { skip(length); }
+
+    void size_items(byte_array&, size_t length) const { skip(length); }
+
+    void size_items(std::string_view&, size_t length) const { skip(length); }
+
+    template <class T>
+    void size_items(std::vector<T>&, size_t length) const
+    {
+        if constexpr (is_fixed_size<T>) {
+            read_.require(length, static_size<T>);
+            skip(length * static_size<T>);
+        } else {
+            for (; length; --length) {
+                T scratch;
+                (*this)(scratch);
+            }
+        }
+    }
+
+    template <class K, class V>
+    void size_items(std::unordered_map<K, V>&, size_t length) const
     {
-        // std::cout << "r(map)" << std::endl;
-        uint16_t length;
-        (*this)(length);
         for (; length; --length) {
             K key;
             (*this)(key);
             V val;
             (*this)(val);
-            kvs.emplace(key, val);
         }
     }
 
-    // Read varsized field
-    // Must have a parent type otherwise we couldn't read it.
+    template <typename T, size_t N, typename P = void>
+    auto operator()(std::array<T, N>& arr, P* = nullptr) const ->
+        typename std::enable_if<!is_fixed_size<T>>::type
+    {
+        for (auto& val : arr)
+            (*this)(val);
+    }
 
     template <typename Type, typename Index, size_t Mask, size_t Offset, typename P>
     auto operator()(varsize_field_specification<Type, Index, Mask, Offset>& val, P* parent) const ->
         typename std::enable_if<boost::fusion::traits::is_sequence<P>::value>::type
     {
-        // std::cout << "r(varsize field spec)" << std::endl;
         assert(parent);
-        // We need to extract the flags value out of parent sequence
-        auto vflag = boost::fusion::at<Index>(*parent).value; // do we need bits_type at all?
+        auto vflag = boost::fusion::at<Index>(*parent).value;
         vflag = (vflag >> Offset) & Mask;
         (*this)(val.value, vflag);
     }
 
-    // Read the actual varsized field with proper flags.
-    // This is called from the function above and does not need the parent.
-
     template <typename T, typename V, typename F>
     void operator()(varsize_field_wrapper<T, V>& val, F flag_value) const
     {
-        read_fields()(val, *this, flag_value);
+        detail::dispatch_alternative<T>(flag_value, [&](auto idx) {
+            (*this)(boost::fusion::at_c<decltype(idx)::value>(val.choice_), &val.choice_);
+        });
     }
 
-    // Read optional field
-    // Must have a parent type otherwise we couldn't read it.
-
     template <typename Type, typename Index, size_t N, typename P>
-    auto operator()(optional_field_specification<Type, Index, N>& val, P* parent) const ->
+    auto operator()(optional_field_specification<Type, Index, N>&, P* parent) const ->
         typename std::enable_if<boost::fusion::traits::is_sequence<P>::value>::type
     {
-        // std::cout << "r(optional field spec)" << std::endl;
         assert(parent);
-        auto flag = boost::fusion::at<Index>(*parent).value; // do we need bits_type at all?
-        if (flag & (1 << N)) {
-            Type v;
-            (*this)(v);
-            val = optional_field_specification<Type, Index, N>(std::move(v));
-        } else {
-            val = boost::none;
+        if (boost::fusion::at<Index>(*parent).value & (1 << N)) {
+            Type scratch;
+            (*this)(scratch);
         }
     }
 
-    // To read custom structs, wrap them into BOOST_FUSION_ADOPT_STRUCT and use this instead
-    // of extra overloads.
-    //
-    // Sequence doesn't usually need parent.
-    // Version with parent for sequence member of a sequence.
-    //
     template <class T, typename P = void>
-    auto operator()(T& val, P* = nullptr) const ->
-        typename std::enable_if<boost::fusion::traits::is_sequence<T>::value>::type
+    auto operator()(T& val, P* = nullptr) const -> typename std::enable_if<
+        boost::fusion::traits::is_sequence<T>::value and !is_fixed_size<T>>::type
     {
-        // std::cout << "r(sequence)" << std::endl;
-        boost::fusion::for_each(val, [this, &val](auto& arg) { (*this)(arg, &val); });
+        size_sequence(val, std::make_index_sequence<detail::wire_size<T>::fields>());
     }
 
-    // Read fixed-size array
+    template <class T, size_t... I>
+    void size_sequence(T& val, std::index_sequence<I...>) const
+    {
+        (size_member<I>(val), ...);
+    }
 
-    template <typename T, size_t N, typename P = void>
-    void operator()(std::array<T, N>& arr, P* = nullptr) const
+    // Flags and bit fields are read, since they may decide about the following fields.
+
+    template <size_t I, class T>
+    void size_member(T& val) const
     {
-        // std::cout << "r(fixarray)" << std::endl;
-        for (auto& val : arr)
-            (*this)(val);
+        if constexpr (detail::wire_size<T>::field_bits[I]) {
+            read_.template read_member<I>(val);
+        } else if constexpr (detail::is_field_flag<detail::field_type_t<T, I>>::value) {
+            read_(boost::fusion::at_c<I>(val));
+        } else {
+            (*this)(boost::fusion::at_c<I>(val), &val);
+        }
     }
 
-    // Read nothing
+    template <class T, class Sum, typename P = void>
+    auto operator()(checksummed<T, Sum>& val, P* = nullptr) const ->
+        typename std::enable_if<!is_fixed_size<T>>::type
+    {
+        (*this)(val.value);
+        skip(sizeof(typename Sum::type));
+    }
 
-    template <typename P = void>
-    void operator()(nothing_t&, P* = nullptr) const
+    template <class T, typename P = void>
+    auto operator()(lazy<T>&, P* = nullptr) const -> typename std::enable_if<!is_fixed_size<T>>::type
     {
-        // std::cout << "r(nothing)" << std::endl;
-        // Do nothing!
+        T scratch;
+        (*this)(scratch);
     }
 
-    // Read until the end of the buffer
-    // @todo Simply return buf_ to reduce copying?
+    template <typename P = void>
+    void operator()(rest_t&, P* = nullptr) const
+    {
+        skip(boost::asio::buffer_size(read_.buf_));
+    }
 
     template <typename P = void>
-    void operator()(rest_t& rest, P* = nullptr) const
+    void operator()(rest_view&, P* = nullptr) const
     {
-        // std::cout << "Grabbing rest of the packet, size = " << boost::asio::buffer_size(buf_) <<
-        // std::endl;
-        rest.data = std::string(boost::asio::buffer_cast<char const*>(buf_),
-                                boost::asio::buffer_size(buf_));
-        // hexdump(rest.data);
-        buf_ = buf_ + boost::asio::buffer_size(buf_);
+        skip(boost::asio::buffer_size(read_.buf_));
     }
 };
 
+/**
+ * Number of bytes occupied by the T encoded at the start of the buffer.
+ * Throws buffer_overrun if the buffer ends before the value does.
+ */
 template <typename T>
-boost::asio::const_buffer
-read(T& val, boost::asio::const_buffer b)
+size_t encoded_size(boost::asio::const_buffer b)
 {
-    reader r(std::move(b));
-    r(val);
-    // std::cout << "Remaining buffer space after read " << boost::asio::buffer_size(r.buf_) << "
-    // bytes" << std::endl;
-    return r.buf_;
+    sizer s(b);
+    T scratch;
+    s(scratch);
+    return boost::asio::buffer_size(b) - boost::asio::buffer_size(s.read_.buf_);
 }
 
 //=================================================================================================
 // Writer
 //=================================================================================================
 
-struct writer
+template <typename Bounds>
+struct generic_writer
 {
     mutable boost::asio::mutable_buffer buf_;
 
-    explicit writer(boost::asio::mutable_buffer buf)
+    explicit generic_writer(boost::asio::mutable_buffer buf)
         : buf_(std::move(buf))
     {
     }
 
+    // Make sure the next n bytes are writable. No-op for unchecked writers.
+
+    void require(size_t n) const
+    {
+        if constexpr (is_checked<Bounds>) {
+            if (boost::asio::buffer_size(buf_) < n) {
+                throw buffer_overrun("need " + std::to_string(n) + " bytes to write, have "
+                                     + std::to_string(boost::asio::buffer_size(buf_)));
+            }
+        }
+    }
+
+    // Copy raw bytes to the wire.
+
+    void store(void const* data, size_t size) const
+    {
+        require(size);
+        std::memcpy(boost::asio::buffer_cast<void*>(buf_), data, size);
+        buf_ = buf_ + size;
+    }
+
+    // Store a trivially copyable value to the wire.
+
+    template <typename T>
+    void put(T const& val) const
+    {
+        require(sizeof(T));
+        detail::store(boost::asio::buffer_cast<void*>(buf_), val);
+        buf_ = buf_ + sizeof(T);
+    }
+
+    // Write the length prefix of a container, uint16_t unless customized with prefixed<>.
+
+    template <class L = uint16_t>
+    void length(size_t n) const
+    {
+        if (n > detail::max_length<L>::value) {
+            throw value_overflow("container of " + std::to_string(n)
+                                 + " items does not fit its length prefix");
+        }
+        (*this)(L(n));
+    }
+
     // Write integral values
 
     template <class T>
     auto operator()(T const& val) const -> typename std::enable_if<std::is_integral<T>::value>::type
     {
-        boost::asio::buffer_copy(buf_, boost::asio::buffer(&val, sizeof(T)));
-        buf_ = buf_ + sizeof(T);
+        put(val);
     }
 
     template <typename T>
     auto operator()(T const& val) const -> typename std::enable_if<is_endian<T>::value>::type
     {
-        boost::asio::buffer_copy(buf_, boost::asio::buffer(&val, sizeof(T)));
-        buf_ = buf_ + sizeof(T);
+        put(val);
     }
 
     template <typename T, size_t N>
     auto operator()(field_flag<T, N> const& val) const -> void
     {
-        boost::asio::buffer_copy(buf_, boost::asio::buffer(&val.value, sizeof(T)));
-        buf_ = buf_ + sizeof(T);
+        put(val.value);
+    }
+
+    // Write variable-length integers
+
+    template <typename T>
+    void operator()(varint<T> const& val) const
+    {
+        uint8_t bytes[detail::max_leb128_size];
+        store(bytes, detail::encode_leb128(val.value, bytes));
+    }
+
+    template <typename T>
+    void operator()(zigzag<T> const& val) const
+    {
+        uint8_t bytes[detail::max_leb128_size];
+        store(bytes, detail::encode_leb128(detail::zigzag_encode(val.value), bytes));
+    }
+
+    void operator()(quic_varint const& val) const
+    {
+        if (val.value > quic_varint::max) {
+            throw value_overflow("quic varint value " + std::to_string(val.value)
+                                 + " does not fit 62 bits");
+        }
+        uint8_t bytes[sizeof(uint64_t)];
+        store(bytes, detail::encode_quic_varint(val.value, bytes));
     }
 
     // Write enums
@@ -447,19 +1909,57 @@ struct writer
 
     void operator()(std::string const& val) const
     {
-        (*this)(static_cast<uint16_t>(val.size()));
-        boost::asio::buffer_copy(buf_, boost::asio::buffer(val));
-        buf_ = buf_ + val.size() + sizeof(uint16_t);
+        length(val.size());
+        write_items(val);
+    }
+
+    void operator()(std::string_view const& val) const
+    {
+        length(val.size());
+        write_items(val);
+    }
+
+    void operator()(byte_array const& val) const
+    {
+        length(val.size());
+        write_items(val);
+    }
+
+    void operator()(boost::string_ref const& val) const
+    {
+        length(val.size());
+        store(val.data(), val.size());
     }
 
     // Write vectors
+    // Elements with wire-compatible layout are copied in one block.
 
     template <class T>
     void operator()(std::vector<T> const& vals) const
     {
-        (*this)(static_cast<uint16_t>(vals.size()));
-        for (auto&& val : vals)
-            (*this)(val);
+        length(vals.size());
+        write_items(vals);
+    }
+
+    template <boost::endian::order Order, class T>
+    void operator()(endian_vector<Order, T> const& vals) const
+    {
+        length(vals.size());
+        size_t size = vals.size() * sizeof(T);
+        require(size);
+        char* out = boost::asio::buffer_cast<char*>(buf_);
+        for (size_t i = 0; i < vals.size(); ++i) {
+            detail::store_ordered<Order>(out + i * sizeof(T), vals[i]);
+        }
+        buf_ = buf_ + size;
+    }
+
+    template <class T>
+    void operator()(span_view<T> const& vals) const
+    {
+        length(vals.size());
+        store(boost::asio::buffer_cast<void const*>(vals.data()),
+              boost::asio::buffer_size(vals.data()));
     }
 
     // Write map
@@ -467,7 +1967,45 @@ struct writer
     template <class K, class V>
     void operator()(std::unordered_map<K, V> const& kvs) const
     {
-        (*this)(static_cast<uint16_t>(kvs.size()));
+        length(kvs.size());
+        write_items(kvs);
+    }
+
+    // Write containers with a custom length prefix
+
+    template <class L, class C>
+    void operator()(prefixed<L, C> const& val) const
+    {
+        length<L>(val.size());
+        write_items(static_cast<C const&>(val));
+    }
+
+    // Container contents following the length prefix
+
+    void write_items(std::string_view const& val) const { store(val.data(), val.size()); }
+
+    // A template, so that strings keep converting to string_view only.
+    template <class B>
+    auto write_items(B const& val) const ->
+        typename std::enable_if<std::is_same<B, byte_array>::value>::type
+    {
+        store(val.data(), val.size());
+    }
+
+    template <class T>
+    void write_items(std::vector<T> const& vals) const
+    {
+        if constexpr (detail::is_bitwise<T>::value) {
+            store(vals.data(), vals.size() * sizeof(T));
+        } else {
+            for (auto&& val : vals)
+                (*this)(val);
+        }
+    }
+
+    template <class K, class V>
+    void write_items(std::unordered_map<K, V> const& kvs) const
+    {
         for (auto& kv : kvs) {
             (*this)(kv.first);
             (*this)(kv.second);
@@ -496,12 +2034,66 @@ struct writer
     }
 
     // Write fusion structs
+    // Same as for reading, the fixed prefix is checked for space once.
 
     template <class T>
     auto operator()(T const& val) const ->
         typename std::enable_if<boost::fusion::traits::is_sequence<T>::value>::type
     {
-        boost::fusion::for_each(val, *this);
+        using layout = detail::wire_size<T>;
+        constexpr size_t prefix = is_checked<Bounds> ? layout::prefix_fields : 0;
+
+        if constexpr (prefix > 0) {
+            require(layout::prefix_size);
+            generic_writer<bounds_unchecked> fixed(buf_);
+            fixed.write_sequence(val, detail::index_range<0, prefix>());
+            buf_ = fixed.buf_;
+        }
+        write_sequence(val, detail::index_range<prefix, layout::fields>());
+    }
+
+    template <class T, size_t... I>
+    void write_sequence(T const& val, std::index_sequence<I...>) const
+    {
+        (write_member<I>(val), ...);
+    }
+
+    // Write a field of a struct.
+    // A run of bit fields is combined and stored as one word at its first field.
+
+    template <size_t I, class T>
+    void write_member(T const& val) const
+    {
+        using layout = detail::wire_size<T>;
+        if constexpr (!layout::field_bits[I]) {
+            (*this)(boost::fusion::at_c<I>(val));
+        } else if constexpr (detail::starts_bit_run(layout::field_bits, I)) {
+            constexpr size_t end   = detail::bit_run_end(layout::field_bits, layout::fields, I);
+            constexpr size_t bytes = layout::field_size[I];
+            require(bytes);
+            detail::store_big_word<bytes>(boost::asio::buffer_cast<void*>(buf_),
+                                          pack_bits(val, detail::index_range<I, end>()));
+            buf_ = buf_ + bytes;
+        }
+    }
+
+    template <class T, size_t... J>
+    uint64_t pack_bits(T const& val, std::index_sequence<J...>) const
+    {
+        using layout = detail::wire_size<T>;
+        return ((bit_field_value(boost::fusion::at_c<J>(val))
+                 << detail::bit_run_shift(layout::field_bits, layout::fields, J))
+                | ...);
+    }
+
+    template <size_t N, typename V>
+    static uint64_t bit_field_value(bits<N, V> const& field)
+    {
+        if (field.value > bits<N, V>::mask) {
+            throw value_overflow("value " + std::to_string(field.value) + " does not fit "
+                                 + std::to_string(N) + " bits");
+        }
+        return field.value;
     }
 
     // Write fixed-size array
@@ -509,8 +2101,17 @@ struct writer
     template <typename T, size_t N>
     void operator()(std::array<T, N> const& arr) const
     {
-        for (auto& val : arr)
-            (*this)(val);
+        if constexpr (detail::is_bitwise<T>::value) {
+            store(arr.data(), N * sizeof(T));
+        } else if constexpr (is_checked<Bounds> and is_fixed_size<T>) {
+            require(static_size<std::array<T, N>>);
+            generic_writer<bounds_unchecked> fixed(buf_);
+            fixed(arr);
+            buf_ = fixed.buf_;
+        } else {
+            for (auto& val : arr)
+                (*this)(val);
+        }
     }
 
     template <typename Type, typename Index, size_t Mask, size_t Offset>
@@ -532,15 +2133,44 @@ struct writer
             (*this)(val.get());
         }
     }
+    // Write a value followed by the checksum of its bytes
+
+    template <class T, class Sum>
+    void operator()(checksummed<T, Sum> const& val) const
+    {
+        auto start = boost::asio::buffer_cast<char const*>(buf_);
+        (*this)(val.value);
+        (*this)(big<typename Sum::type>(
+            Sum::compute(start, boost::asio::buffer_cast<char const*>(buf_) - start)));
+    }
+
+    // Write the recorded bytes of a lazy field
+
+    template <class T>
+    void operator()(lazy<T> const& val) const
+    {
+        store(boost::asio::buffer_cast<void const*>(val.buf_), val.size());
+    }
+
     // Write the final remainder of the buffer
 
     void operator()(rest_t const& rest) const
     {
-        boost::asio::buffer_copy(buf_, boost::asio::buffer(rest.data));
-        buf_ = buf_ + rest.data.size();
+        store(rest.data.data(), rest.data.size());
+    }
+
+    void operator()(rest_view const& rest) const
+    {
+        store(boost::asio::buffer_cast<void const*>(rest.data), rest.size());
     }
 };
 
+using writer = generic_writer<bounds_checked>;
+
+/**
+ * Write a value into the buffer, return the unused remainder.
+ * Throws buffer_overrun if the value does not fit.
+ */
 template <typename T>
 boost::asio::mutable_buffer
 write(boost::asio::mutable_buffer b, T const& val)
@@ -0,0 +1,154 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "arsenal/fusionary.hpp"
+#include <tuple>
+
+//=================================================================================================
+// Batch decoding
+//=================================================================================================
+
+namespace arsenal::fusionary
+{
+
+namespace detail
+{
+
+// Native type a field is decoded to in a batch column, and how to load it from a packet.
+
+template <typename F, typename Enable = void>
+struct column_traits
+{
+    using type = F;
+
+    static type load(char const* p)
+    {
+        F val;
+        generic_reader<bounds_unchecked> r(boost::asio::const_buffer(p, static_size<F>));
+        r(val);
+        return val;
+    }
+};
+
+template <typename F>
+struct column_traits<F, std::enable_if_t<std::is_integral<F>::value>>
+{
+    using type = F;
+
+    static type load(char const* p) { return detail::load<F>(p); }
+};
+
+template <boost::endian::order Order, class T, std::size_t n, boost::endian::align A>
+struct column_traits<boost::endian::endian_arithmetic<Order, T, n, A>,
+                     std::enable_if_t<n == 8 * sizeof(T)>>
+{
+    using type = T;
+
+    static type load(char const* p) { return load_ordered<Order, T>(p); }
+};
+
+// Bit fields are cut out of their run by decode_field().
+template <size_t N, typename T>
+struct column_traits<bits<N, T>>
+{
+    using type = T;
+};
+
+template <typename T, size_t I>
+using column_type_t = typename column_traits<field_type_t<T, I>>::type;
+
+template <typename T, typename Fields = std::make_index_sequence<wire_size<T>::fields>>
+struct batch_columns;
+
+template <typename T, size_t... I>
+struct batch_columns<T, std::index_sequence<I...>>
+{
+    using type = std::tuple<std::vector<column_type_t<T, I>>...>;
+};
+
+template <typename T, size_t I>
+inline column_type_t<T, I> decode_field(char const* packet)
+{
+    using layout = wire_size<T>;
+    using field  = field_type_t<T, I>;
+
+    if constexpr (layout::field_bits[I] != 0) {
+        constexpr size_t begin  = bit_run_begin(layout::field_bits, I);
+        constexpr size_t offset = sum_first(layout::field_size, begin);
+        constexpr size_t bytes  = bit_run_width(layout::field_bits, layout::fields, begin) / 8;
+        constexpr size_t shift  = bit_run_shift(layout::field_bits, layout::fields, I);
+        uint64_t word = load_big_word<bytes>(packet + offset);
+        return static_cast<column_type_t<T, I>>((word >> shift) & field::mask);
+    } else {
+        return column_traits<field>::load(packet + sum_first(layout::field_size, I));
+    }
+}
+
+// Packets sit in separate receive slots, so each one is decoded completely while its cache
+// lines are loaded, with the fields going out to the columns as sequential stores.
+// Offsets are constants: every field is a single load, byte swap and store.
+
+template <typename T, typename Columns, typename Buffers, size_t... I>
+void decode_rows(Columns& cols, size_t start, Buffers const& packets, std::index_sequence<I...>)
+{
+    auto out     = std::make_tuple(std::get<I>(cols).data() + start...);
+    size_t index = 0;
+    for (auto const& packet : packets) {
+        boost::asio::const_buffer buf(packet);
+        if (boost::asio::buffer_size(buf) < static_size<T>) {
+            throw buffer_overrun("need " + std::to_string(static_size<T>) + " bytes in packet "
+                                 + std::to_string(index) + " of the batch, have "
+                                 + std::to_string(boost::asio::buffer_size(buf)));
+        }
+        char const* p = boost::asio::buffer_cast<char const*>(buf);
+        ((*std::get<I>(out)++ = decode_field<T, I>(p)), ...);
+        ++index;
+    }
+}
+
+} // detail namespace
+
+/**
+ * Struct-of-arrays storage for a fixed-size fusion struct: one vector per field, holding the
+ * native value of endian and bit fields.
+ */
+template <typename T>
+using columns = typename detail::batch_columns<T>::type;
+
+/**
+ * Decode a batch of packets, e.g. from a single recvmmsg() call, appending one row per
+ * packet to the columns. Returns the number of packets decoded.
+ *
+ * T must have a fixed size. Packets longer than it are accepted, the rest is ignored.
+ * Throws buffer_overrun if a packet is too short and invalid_encoding if a marker does not
+ * match, nothing is appended to the columns then.
+ */
+template <typename T, typename Buffers>
+size_t read_batch(Buffers const& packets, columns<T>& cols)
+{
+    static_assert(is_fixed_size<T>, "batches are decoded for fixed-size structs only");
+    constexpr size_t fields = detail::wire_size<T>::fields;
+
+    size_t count = std::distance(std::begin(packets), std::end(packets));
+    size_t start = std::get<0>(cols).size();
+    auto resize  = [&](size_t size) {
+        std::apply([size](auto&... col) { (col.resize(size), ...); }, cols);
+    };
+    resize(start + count);
+    try {
+        detail::decode_rows<T>(cols, start, packets, std::make_index_sequence<fields>());
+    } catch (...) {
+        resize(start);
+        throw;
+    }
+    return count;
+}
+
+} // arsenal::fusionary namespace
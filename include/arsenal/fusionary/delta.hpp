@@ -0,0 +1,243 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "arsenal/fusionary.hpp"
+#include <boost/fusion/include/equal_to.hpp>
+
+//=================================================================================================
+// Delta encoding
+//=================================================================================================
+//
+// A record is encoded as a varint header followed by the fields that differ from the
+// previous record of the stream. Header bit 0 marks a key record, which is relative to a
+// default-constructed struct instead, bit i + 1 is set when field i is present.
+//
+// Integer fields (plain, endian and bit fields) are sent as the zigzag varint of their
+// difference from the previous value, modulo their width, so counters and slowly moving
+// readings take a byte or two. Other fields are sent whole when they are not equal to the
+// previous value.
+
+namespace arsenal::fusionary
+{
+
+namespace detail
+{
+
+template <typename F, typename Enable = void>
+struct integer_field : std::false_type
+{
+};
+
+template <typename F>
+struct integer_field<F, std::enable_if_t<std::is_integral<F>::value
+                                         and !std::is_same<F, bool>::value>> : std::true_type
+{
+    using type = F;
+    static constexpr size_t width = 8 * sizeof(F);
+
+    static type get(F const& field) { return field; }
+    static void set(F& field, type v) { field = v; }
+};
+
+template <boost::endian::order Order, class T, std::size_t n, boost::endian::align A>
+struct integer_field<boost::endian::endian_arithmetic<Order, T, n, A>> : std::true_type
+{
+    using type = T;
+    static constexpr size_t width = n;
+
+    static type get(boost::endian::endian_arithmetic<Order, T, n, A> const& field)
+    {
+        return field.value();
+    }
+    static void set(boost::endian::endian_arithmetic<Order, T, n, A>& field, type v)
+    {
+        field = v;
+    }
+};
+
+template <size_t N, typename T>
+struct integer_field<bits<N, T>> : std::true_type
+{
+    using type = T;
+    static constexpr size_t width = N;
+
+    static type get(bits<N, T> const& field) { return field.value; }
+    static void set(bits<N, T>& field, type v) { field.value = v; }
+};
+
+template <typename F>
+bool same_field(F const& a, F const& b)
+{
+    if constexpr (integer_field<F>::value) {
+        return integer_field<F>::get(a) == integer_field<F>::get(b);
+    } else if constexpr (boost::fusion::traits::is_sequence<F>::value) {
+        return boost::fusion::equal_to(a, b);
+    } else {
+        return a == b;
+    }
+}
+
+template <typename F>
+void write_field_delta(writer const& w, F const& previous, F const& val)
+{
+    if constexpr (integer_field<F>::value) {
+        using field          = integer_field<F>;
+        constexpr size_t pad = 64 - field::width;
+        uint64_t diff = uint64_t(field::get(val)) - uint64_t(field::get(previous));
+        // Sign-extend the difference from the field width.
+        w(zigzag<int64_t>(int64_t(diff << pad) >> pad));
+    } else {
+        w(val);
+    }
+}
+
+template <typename F, typename P>
+void read_field_delta(reader const& r, F& val, P* parent)
+{
+    if constexpr (integer_field<F>::value) {
+        using field = integer_field<F>;
+        zigzag<int64_t> diff;
+        r(diff);
+        uint64_t v = uint64_t(field::get(val)) + uint64_t(diff.value);
+        if constexpr (field::width < 64) {
+            v &= ~uint64_t(0) >> (64 - field::width);
+        }
+        field::set(val, static_cast<typename field::type>(v));
+    } else {
+        r(val, parent);
+    }
+}
+
+} // detail namespace
+
+/**
+ * Encodes successive records of one stream as differences from the previous record.
+ * Use one encoder per stream, paired with a delta_decoder on the receiving side.
+ *
+ * The first record, and the first one after reset(), is a key record: decoders can start
+ * from it, and it lets a decoder that lost a record resynchronize.
+ */
+template <typename T>
+class delta_encoder
+{
+    static_assert(boost::fusion::traits::is_sequence<T>::value, "records must be fusion structs");
+    static constexpr size_t fields = detail::wire_size<T>::fields;
+    static_assert(fields < 64, "the changed field bitmap holds up to 63 fields");
+
+    T previous_{};
+    bool key_{true};
+
+    template <size_t... I>
+    uint64_t changed_fields(T const& val, std::index_sequence<I...>) const
+    {
+        return ((uint64_t(!detail::same_field(boost::fusion::at_c<I>(val),
+                                              boost::fusion::at_c<I>(previous_)))
+                 << I)
+                | ...);
+    }
+
+    template <size_t... I>
+    void write_fields(writer const& w, uint64_t changed, T const& val,
+                      std::index_sequence<I...>) const
+    {
+        ((changed & (uint64_t(1) << I)
+              ? detail::write_field_delta(w, boost::fusion::at_c<I>(previous_),
+                                          boost::fusion::at_c<I>(val))
+              : void()),
+         ...);
+    }
+
+public:
+    /**
+     * Make the next record a key record.
+     */
+    void reset() { key_ = true; }
+
+    /**
+     * Encode val relative to the previous record, return the unused remainder of buf.
+     * Throws buffer_overrun if buf is too small, the stream state is unchanged then.
+     */
+    boost::asio::mutable_buffer write(boost::asio::mutable_buffer buf, T const& val)
+    {
+        if (key_) {
+            previous_ = T();
+        }
+        auto indices     = std::make_index_sequence<fields>();
+        uint64_t changed = changed_fields(val, indices);
+
+        writer w(std::move(buf));
+        w(varint<uint64_t>((changed << 1) | key_));
+        write_fields(w, changed, val, indices);
+
+        previous_ = val;
+        key_      = false;
+        return w.buf_;
+    }
+};
+
+/**
+ * Decodes the records of one stream written by a delta_encoder.
+ *
+ * Records must arrive in order. After a decoding error or before the first key record,
+ * records are rejected with invalid_encoding until the next key record.
+ */
+template <typename T>
+class delta_decoder
+{
+    static_assert(boost::fusion::traits::is_sequence<T>::value, "records must be fusion structs");
+    static constexpr size_t fields = detail::wire_size<T>::fields;
+    static_assert(fields < 64, "the changed field bitmap holds up to 63 fields");
+
+    T current_{};
+    bool synchronized_{false};
+
+    template <size_t... I>
+    void read_fields(reader const& r, uint64_t changed, std::index_sequence<I...>)
+    {
+        ((changed & (uint64_t(1) << I)
+              ? detail::read_field_delta(r, boost::fusion::at_c<I>(current_), &current_)
+              : void()),
+         ...);
+    }
+
+public:
+    /**
+     * The last record decoded.
+     */
+    T const& value() const { return current_; }
+
+    /**
+     * Decode the next record, return the unread remainder of buf.
+     */
+    boost::asio::const_buffer read(boost::asio::const_buffer buf)
+    {
+        reader r(std::move(buf));
+        varint<uint64_t> header;
+        r(header);
+        uint64_t changed = header.value >> 1;
+        if (changed >> fields) {
+            synchronized_ = false;
+            throw invalid_encoding("delta record has fields beyond " + std::to_string(fields));
+        }
+        if (header.value & 1) {
+            current_      = T();
+            synchronized_ = true;
+        } else if (!synchronized_) {
+            throw invalid_encoding("delta record without a preceding key record");
+        }
+
+        synchronized_ = false;
+        read_fields(r, changed, std::make_index_sequence<fields>());
+        synchronized_ = true;
+        return r.buf_;
+    }
+};
+
+} // arsenal::fusionary namespace
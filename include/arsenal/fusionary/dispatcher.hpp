@@ -0,0 +1,210 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "arsenal/fusionary.hpp"
+
+//=================================================================================================
+// Message dispatcher
+//=================================================================================================
+
+namespace arsenal::fusionary
+{
+
+namespace detail
+{
+
+// Constant marker a message starts with: its first field, or the first field of its first
+// nested struct.
+
+template <typename T, typename = void>
+struct message_tag
+{
+    static_assert(sizeof(T) == 0, "dispatched messages must start with an integral_constant");
+};
+
+template <typename T, T v>
+struct message_tag<std::integral_constant<T, v>> : std::integral_constant<T, v>
+{
+};
+
+template <typename T>
+struct message_tag<T, std::enable_if_t<boost::fusion::traits::is_sequence<T>::value>>
+    : message_tag<field_type_t<T, 0>>
+{
+};
+
+template <typename T, size_t N>
+constexpr bool all_distinct(T const (&values)[N])
+{
+    for (size_t i = 0; i < N; ++i) {
+        for (size_t j = i + 1; j < N; ++j) {
+            if (values[i] == values[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename T, size_t N>
+constexpr T min_value(T const (&values)[N])
+{
+    T result = values[0];
+    for (size_t i = 1; i < N; ++i) {
+        result = values[i] < result ? values[i] : result;
+    }
+    return result;
+}
+
+template <typename T, size_t N>
+constexpr T max_value(T const (&values)[N])
+{
+    T result = values[0];
+    for (size_t i = 1; i < N; ++i) {
+        result = values[i] > result ? values[i] : result;
+    }
+    return result;
+}
+
+// Position of each value in values, indexed by its distance from base. Slots no value maps
+// to hold N, values too far from base are left out.
+
+template <size_t Size, typename T, size_t N>
+constexpr std::array<uint8_t, Size> slot_table(T const (&values)[N], T base)
+{
+    std::array<uint8_t, Size> slots{};
+    for (size_t i = 0; i < Size; ++i) {
+        slots[i] = N;
+    }
+    for (size_t i = 0; i < N; ++i) {
+        uint64_t slot = uint64_t(values[i]) - uint64_t(base);
+        if (slot < Size) {
+            slots[slot] = i;
+        }
+    }
+    return slots;
+}
+
+// Read the rest of a message whose marker was already consumed.
+// The fixed prefix is checked for space once, as in a regular read.
+
+template <typename Bounds, typename T>
+void read_after_tag(T& msg, generic_reader<Bounds> const& r)
+{
+    if constexpr (boost::fusion::traits::is_sequence<T>::value) {
+        using layout = wire_size<T>;
+        using tag_type = typename message_tag<T>::value_type;
+        constexpr size_t prefix = is_checked<Bounds> ? layout::prefix_fields : 0;
+
+        if constexpr (prefix > 0) {
+            r.require(layout::prefix_size - sizeof(tag_type));
+            generic_reader<bounds_unchecked> fixed(r.buf_);
+            read_after_tag(boost::fusion::at_c<0>(msg), fixed);
+            fixed.read_sequence(msg, index_range<1, prefix>());
+            r.buf_ = fixed.buf_;
+            r.read_sequence(msg, index_range<prefix, layout::fields>());
+        } else {
+            read_after_tag(boost::fusion::at_c<0>(msg), r);
+            r.read_sequence(msg, index_range<1, layout::fields>());
+        }
+    }
+}
+
+} // detail namespace
+
+/**
+ * Decodes packets which may be any of the given messages, told apart by the constant marker
+ * each of them starts with.
+ *
+ *   dispatcher<hello, data, bye>::dispatch(buf, overloaded{
+ *       [](hello& m) { ... },
+ *       [](data& m) { ... },
+ *       [](bye& m) { ... }});
+ *
+ * The marker is loaded once and looked up in a table built at compile time, indexed by the
+ * marker value when the markers span at most 256 values. Only the matching message is then
+ * decoded, from past the marker, and passed to the handler.
+ * All markers must have the same type and distinct values.
+ */
+template <typename... Msgs>
+class dispatcher
+{
+    using tag_type = std::common_type_t<typename detail::message_tag<Msgs>::value_type...>;
+
+    static_assert(sizeof...(Msgs) > 0, "nothing to dispatch");
+    static_assert((std::is_same<typename detail::message_tag<Msgs>::value_type, tag_type>::value
+                   and ...),
+                  "all markers must have the same type");
+
+    static constexpr tag_type tags[] = {detail::message_tag<Msgs>::value...};
+    static_assert(detail::all_distinct(tags), "markers must be distinct");
+    static_assert(sizeof...(Msgs) < 256, "too many messages");
+
+    static constexpr tag_type min_tag = detail::min_value(tags);
+    static constexpr uint64_t tag_range = uint64_t(detail::max_value(tags)) - uint64_t(min_tag);
+    static constexpr bool dense = tag_range < 256;
+
+    // Position in tags[] by marker value, for dense markers.
+    static constexpr auto slots = detail::slot_table<dense ? tag_range + 1 : 1>(tags, min_tag);
+
+    static size_t index_of(tag_type tag)
+    {
+        if constexpr (dense) {
+            uint64_t slot = uint64_t(tag) - uint64_t(min_tag);
+            return slot <= tag_range ? slots[slot] : sizeof...(Msgs);
+        } else {
+            size_t i = 0;
+            while (i < sizeof...(Msgs) and tags[i] != tag) {
+                ++i;
+            }
+            return i;
+        }
+    }
+
+    template <typename Msg, typename Handler>
+    static void decode(reader const& r, Handler& handler)
+    {
+        Msg msg;
+        detail::read_after_tag(msg, r);
+        handler(msg);
+    }
+
+public:
+    /**
+     * Whether one of the messages starts with the given marker.
+     */
+    static constexpr bool accepts(tag_type tag)
+    {
+        return ((tag == detail::message_tag<Msgs>::value) or ...);
+    }
+
+    /**
+     * Decode the message in buf and call handler with it, return the unread remainder.
+     * Throws invalid_encoding if no message has the marker found in the buffer.
+     */
+    template <typename Handler>
+    static boost::asio::const_buffer dispatch(boost::asio::const_buffer buf, Handler&& handler)
+    {
+        using handler_type = std::remove_reference_t<Handler>;
+        static constexpr void (*decoders[])(reader const&, handler_type&)
+            = {&decode<Msgs, handler_type>...};
+
+        reader r(std::move(buf));
+        tag_type tag = r.fetch<tag_type>();
+        size_t index = index_of(tag);
+        if (index == sizeof...(Msgs)) {
+            throw invalid_encoding("no message with marker " + std::to_string(tag));
+        }
+        decoders[index](r, handler);
+        return r.buf_;
+    }
+};
+
+} // arsenal::fusionary namespace
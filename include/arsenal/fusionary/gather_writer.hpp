@@ -0,0 +1,267 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "arsenal/fusionary.hpp"
+#include <boost/container/small_vector.hpp>
+
+//=================================================================================================
+// Gather writer
+//=================================================================================================
+
+namespace arsenal::fusionary
+{
+
+namespace detail
+{
+
+// Containers whose contents are laid out in memory exactly as on the wire.
+
+template <class C>
+struct is_contiguous_payload : std::false_type
+{};
+
+template <>
+struct is_contiguous_payload<std::string> : std::true_type
+{};
+
+template <>
+struct is_contiguous_payload<byte_array> : std::true_type
+{};
+
+template <class T>
+struct is_contiguous_payload<std::vector<T>> : is_bitwise<T>
+{};
+
+} // detail namespace
+
+/**
+ * Buffer sequence produced by the gather writer, usable with async_send() or sendmsg().
+ */
+using gather_buffers = boost::container::small_vector<boost::asio::const_buffer, 8>;
+
+/**
+ * Writer that copies only the small fields into a header buffer and references large
+ * payloads in place.
+ *
+ * Payloads at least threshold bytes long (strings, views, lazy and rest fields, and vectors
+ * of wire-compatible elements, with a default or prefixed<> length) are referenced, not
+ * copied. Their length prefix goes into the header buffer, then the header written so far
+ * and the payload itself are appended to the output buffer sequence. Everything else is
+ * written by the regular writer into the header.
+ *
+ * Referenced payloads must outlive the returned buffer sequence.
+ */
+class gather_writer
+{
+    mutable boost::asio::mutable_buffer header_;
+    mutable char* segment_start_;
+    mutable gather_buffers buffers_;
+    size_t threshold_;
+
+public:
+    static constexpr size_t default_threshold = 256;
+
+    explicit gather_writer(boost::asio::mutable_buffer header,
+                           size_t threshold = default_threshold)
+        : header_(std::move(header))
+        , segment_start_(boost::asio::buffer_cast<char*>(header_))
+        , threshold_(threshold)
+    {
+    }
+
+    // Complete buffer sequence, including the trailing part of the header.
+
+    gather_buffers const& buffers() const
+    {
+        flush();
+        return buffers_;
+    }
+
+    // Fusion structs are walked field by field, so that payloads nested in them are found.
+    // Fixed-size ones have no payloads and go straight into the header.
+
+    template <class T>
+    auto operator()(T const& val) const ->
+        typename std::enable_if<boost::fusion::traits::is_sequence<T>::value>::type
+    {
+        if constexpr (is_fixed_size<T>) {
+            copy(val);
+        } else {
+            write_sequence(val, std::make_index_sequence<detail::wire_size<T>::fields>());
+        }
+    }
+
+    template <class T>
+    auto operator()(T const& val) const ->
+        typename std::enable_if<!boost::fusion::traits::is_sequence<T>::value>::type
+    {
+        copy(val);
+    }
+
+    void operator()(std::string const& val) const { string_payload(val.data(), val.size(), val); }
+
+    void operator()(std::string_view const& val) const
+    {
+        string_payload(val.data(), val.size(), val);
+    }
+
+    void operator()(byte_array const& val) const { string_payload(val.data(), val.size(), val); }
+
+    void operator()(boost::string_ref const& val) const
+    {
+        string_payload(val.data(), val.size(), val);
+    }
+
+    template <class T>
+    void operator()(std::vector<T> const& vals) const
+    {
+        if constexpr (detail::is_bitwise<T>::value) {
+            if (vals.size() * sizeof(T) >= threshold_) {
+                length(vals.size());
+                reference(vals.data(), vals.size() * sizeof(T));
+                return;
+            }
+        }
+        copy(vals);
+    }
+
+    template <class T>
+    void operator()(span_view<T> const& vals) const
+    {
+        if (boost::asio::buffer_size(vals.data()) >= threshold_) {
+            length(vals.size());
+            reference(vals.data());
+        } else {
+            copy(vals);
+        }
+    }
+
+    template <class L, class C>
+    void operator()(prefixed<L, C> const& val) const
+    {
+        if constexpr (detail::is_contiguous_payload<C>::value) {
+            size_t size = val.size() * sizeof(*val.data());
+            if (size >= threshold_) {
+                length<L>(val.size());
+                reference(val.data(), size);
+                return;
+            }
+        }
+        copy(val);
+    }
+
+    template <class T>
+    void operator()(lazy<T> const& val) const
+    {
+        payload(val.data(), val);
+    }
+
+    void operator()(rest_view const& rest) const { payload(rest.data, rest); }
+
+    void operator()(rest_t const& rest) const
+    {
+        payload(boost::asio::buffer(rest.data), rest);
+    }
+
+private:
+    template <class T, size_t... I>
+    void write_sequence(T const& val, std::index_sequence<I...>) const
+    {
+        (write_member<I>(val), ...);
+    }
+
+    // Runs of bit fields are packed by the regular writer.
+    template <size_t I, class T>
+    void write_member(T const& val) const
+    {
+        if constexpr (detail::wire_size<T>::field_bits[I]) {
+            writer w(header_);
+            w.write_member<I>(val);
+            header_ = w.buf_;
+        } else {
+            (*this)(boost::fusion::at_c<I>(val));
+        }
+    }
+
+    template <class T>
+    void copy(T const& val) const
+    {
+        writer w(header_);
+        w(val);
+        header_ = w.buf_;
+    }
+
+    // Length prefix of a referenced payload goes into the header.
+    template <class L = uint16_t>
+    void length(size_t n) const
+    {
+        writer w(header_);
+        w.length<L>(n);
+        header_ = w.buf_;
+    }
+
+    template <class T>
+    void string_payload(char const* data, size_t size, T const& val) const
+    {
+        if (size >= threshold_) {
+            length(size);
+            reference(boost::asio::const_buffer(data, size));
+        } else {
+            copy(val);
+        }
+    }
+
+    template <class T>
+    void payload(boost::asio::const_buffer data, T const& val) const
+    {
+        if (boost::asio::buffer_size(data) >= threshold_) {
+            reference(data);
+        } else {
+            copy(val);
+        }
+    }
+
+    void reference(void const* data, size_t size) const
+    {
+        reference(boost::asio::const_buffer(data, size));
+    }
+
+    void reference(boost::asio::const_buffer data) const
+    {
+        flush();
+        buffers_.push_back(data);
+    }
+
+    // Append header bytes written since the last reference.
+    void flush() const
+    {
+        char* current = boost::asio::buffer_cast<char*>(header_);
+        if (current != segment_start_) {
+            buffers_.emplace_back(segment_start_, current - segment_start_);
+            segment_start_ = current;
+        }
+    }
+};
+
+/**
+ * Write a value as a sequence of header buffers and referenced payloads.
+ * Throws buffer_overrun if the copied parts do not fit into the header buffer.
+ */
+template <typename T>
+gather_buffers
+gather_write(boost::asio::mutable_buffer header, T const& val,
+             size_t threshold = gather_writer::default_threshold)
+{
+    gather_writer w(std::move(header), threshold);
+    w(val);
+    return w.buffers();
+}
+
+} // arsenal::fusionary namespace
@@ -0,0 +1,170 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "arsenal/fusionary.hpp"
+#include <array>
+#include <cstring>
+#include <memory>
+
+//=================================================================================================
+// Packet builder
+//=================================================================================================
+
+namespace arsenal::fusionary
+{
+
+/**
+ * Buffer for building a packet from the inside out, like a Linux sk_buff.
+ *
+ * Space is reserved in front of and behind the data. The innermost payload is appended
+ * first, then the header of each enclosing protocol layer is prepended in place, so the
+ * payload is never moved and the finished packet is one contiguous buffer.
+ *
+ *   packet_builder pkt(1500, 64);
+ *   pkt.append(payload);
+ *   pkt.prepend(udp_header);
+ *   pkt.prepend(ip_header);
+ *   socket.send(pkt.data());
+ *
+ * Throws buffer_overrun when the headroom or tailroom is exhausted.
+ */
+class packet_builder
+{
+    std::unique_ptr<char[]> owned_;
+    boost::asio::mutable_buffer storage_;
+    size_t head_; // start of the data
+    size_t tail_; // end of the data
+
+    char* base() const { return boost::asio::buffer_cast<char*>(storage_); }
+
+public:
+    /**
+     * Allocate capacity bytes, leaving headroom bytes in front of the data.
+     * The rest of the capacity is tailroom.
+     */
+    packet_builder(size_t capacity, size_t headroom)
+        : owned_(new char[capacity])
+        , storage_(owned_.get(), capacity)
+        , head_(std::min(headroom, capacity))
+        , tail_(head_)
+    {
+    }
+
+    /**
+     * Build the packet in external storage, e.g. a buffer from a pool.
+     */
+    packet_builder(boost::asio::mutable_buffer storage, size_t headroom)
+        : storage_(std::move(storage))
+        , head_(std::min(headroom, boost::asio::buffer_size(storage_)))
+        , tail_(head_)
+    {
+    }
+
+    size_t size() const { return tail_ - head_; }
+    size_t headroom() const { return head_; }
+    size_t tailroom() const { return boost::asio::buffer_size(storage_) - tail_; }
+
+    /**
+     * The packet built so far.
+     */
+    boost::asio::const_buffer data() const { return boost::asio::buffer(base() + head_, size()); }
+
+    /**
+     * Drop the data and start over with the given headroom.
+     */
+    void reset(size_t headroom)
+    {
+        head_ = std::min(headroom, boost::asio::buffer_size(storage_));
+        tail_ = head_;
+    }
+
+    /**
+     * Grow the data by n bytes at the front and return them for writing.
+     */
+    boost::asio::mutable_buffer push(size_t n)
+    {
+        if (n > head_) {
+            throw buffer_overrun("need " + std::to_string(n) + " bytes of headroom, have "
+                                 + std::to_string(head_));
+        }
+        head_ -= n;
+        return boost::asio::buffer(base() + head_, n);
+    }
+
+    /**
+     * Grow the data by n bytes at the back and return them for writing.
+     */
+    boost::asio::mutable_buffer put(size_t n)
+    {
+        if (n > tailroom()) {
+            throw buffer_overrun("need " + std::to_string(n) + " bytes of tailroom, have "
+                                 + std::to_string(tailroom()));
+        }
+        tail_ += n;
+        return boost::asio::buffer(base() + tail_ - n, n);
+    }
+
+    /**
+     * Shrink the data by n bytes at the front, e.g. to strip a header on receive.
+     */
+    void pull(size_t n)
+    {
+        if (n > size()) {
+            throw buffer_overrun("can't pull " + std::to_string(n) + " bytes, have "
+                                 + std::to_string(size()));
+        }
+        head_ += n;
+    }
+
+    /**
+     * Shrink the data to n bytes, dropping the back.
+     */
+    void trim(size_t n)
+    {
+        if (n < size()) {
+            tail_ = head_ + n;
+        }
+    }
+
+    /**
+     * Encode a value in front of the data.
+     * Fixed-size values are encoded on the stack and copied in. Others are encoded at the
+     * start of the headroom first, since their size is not known until then, and moved up
+     * to the data; only the header bytes are moved.
+     * The data is left as it was when encoding throws.
+     */
+    template <typename T>
+    void prepend(T const& val)
+    {
+        if constexpr (is_fixed_size<T>) {
+            std::array<char, static_size<T>> header;
+            write(boost::asio::buffer(header), val);
+            std::memcpy(boost::asio::buffer_cast<char*>(push(header.size())), header.data(),
+                        header.size());
+        } else {
+            auto rest   = write(boost::asio::buffer(base(), head_), val);
+            size_t size = head_ - boost::asio::buffer_size(rest);
+            std::memmove(base() + head_ - size, base(), size);
+            head_ -= size;
+        }
+    }
+
+    /**
+     * Encode a value behind the data.
+     */
+    template <typename T>
+    void append(T const& val)
+    {
+        auto rest = write(boost::asio::buffer(base() + tail_, tailroom()), val);
+        tail_     = boost::asio::buffer_size(storage_) - boost::asio::buffer_size(rest);
+    }
+};
+
+} // arsenal::fusionary namespace
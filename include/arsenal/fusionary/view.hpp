@@ -0,0 +1,138 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "arsenal/fusionary.hpp"
+
+//=================================================================================================
+// Overlay view
+//=================================================================================================
+
+namespace arsenal::fusionary
+{
+
+/**
+ * Read-only view of a fusion struct encoded in a buffer, decoding single fields on access.
+ *
+ *   view<packet> v(buf);
+ *   auto size = v.get<2>();
+ *
+ * Fields of the fixed prefix are at offsets known at compile time, the constructor checks
+ * that the prefix fits, so reading them is a single unchecked load. Offsets of the fields
+ * after it are found by walking over the preceding fields once and cached.
+ *
+ * The view references the buffer, which must outlive it.
+ */
+template <typename T>
+class view
+{
+    static_assert(boost::fusion::traits::is_sequence<T>::value, "view works on fusion structs");
+
+    using layout = detail::wire_size<T>;
+    static constexpr size_t prefix = layout::prefix_fields;
+
+    boost::asio::const_buffer buf_;
+    // Offsets of the variable fields, valid up to index resolved_.
+    mutable std::array<size_t, layout::fields + 1> offsets_;
+    mutable size_t resolved_{prefix};
+    // Receives the flags that optional and varsize fields depend on.
+    mutable T flags_;
+    mutable bool prefix_loaded_{false};
+
+public:
+    explicit view(boost::asio::const_buffer buf)
+        : buf_(std::move(buf))
+    {
+        if (boost::asio::buffer_size(buf_) < layout::prefix_size) {
+            throw buffer_overrun("need " + std::to_string(layout::prefix_size)
+                                 + " bytes for the fixed prefix, have "
+                                 + std::to_string(boost::asio::buffer_size(buf_)));
+        }
+        offsets_[prefix] = layout::prefix_size;
+    }
+
+    /**
+     * Decode field I.
+     */
+    template <size_t I>
+    detail::field_type_t<T, I> get() const
+    {
+        using field_type = detail::field_type_t<T, I>;
+        if constexpr (layout::field_bits[I] != 0) {
+            constexpr size_t begin = detail::bit_run_begin(layout::field_bits, I);
+            if constexpr (begin < prefix) {
+                generic_reader<bounds_unchecked> r(buf_ + offset<begin>());
+                r.template read_member<begin>(flags_);
+            } else {
+                reader r(buf_ + offset<begin>());
+                r.template read_member<begin>(flags_);
+            }
+            return boost::fusion::at_c<I>(flags_);
+        } else if constexpr (I < prefix) {
+            field_type val;
+            generic_reader<bounds_unchecked> r(buf_ + offset<I>());
+            r(val);
+            return val;
+        } else {
+            load_prefix();
+            field_type val;
+            reader r(buf_ + offset<I>());
+            r(val, &flags_);
+            return val;
+        }
+    }
+
+    /**
+     * Encoded bytes of field I.
+     */
+    template <size_t I>
+    boost::asio::const_buffer field_data() const
+    {
+        size_t start = offset<I>();
+        return boost::asio::buffer(buf_ + start, offset<I + 1>() - start);
+    }
+
+    /**
+     * Size of the whole encoded struct.
+     */
+    size_t size() const { return offset<layout::fields>(); }
+
+    boost::asio::const_buffer data() const { return boost::asio::buffer(buf_, size()); }
+
+private:
+    template <size_t I>
+    size_t offset() const
+    {
+        if constexpr (I <= prefix) {
+            return detail::sum_first(layout::field_size, I);
+        } else {
+            if (resolved_ < I) {
+                size_t start = offset<I - 1>();
+                load_prefix();
+                sizer s(buf_ + start);
+                s.template size_member<I - 1>(flags_);
+                offsets_[I] = boost::asio::buffer_size(buf_) - boost::asio::buffer_size(s.read_.buf_);
+                resolved_   = I;
+            }
+            return offsets_[I];
+        }
+    }
+
+    // Flag fields in the fixed prefix, needed for the fields after it.
+    void load_prefix() const
+    {
+        if (!prefix_loaded_) {
+            generic_reader<bounds_unchecked> r(buf_);
+            r.read_sequence(flags_, detail::index_range<0, prefix>());
+            prefix_loaded_ = true;
+        }
+    }
+};
+
+} // arsenal::fusionary namespace
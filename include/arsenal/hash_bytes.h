@@ -0,0 +1,36 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace arsenal
+{
+
+/**
+ * Fast non-cryptographic 64-bit hash of a run of bytes (wyhash), for hash table keys.
+ * Reads eight bytes at a time and mixes them with 64x64->128 bit multiplies.
+ *
+ * Keys chosen by a peer can be crafted to collide for a known seed, tables holding such keys
+ * should use hash_seed() or another secret seed.
+ */
+uint64_t hash_bytes(void const* data, size_t size, uint64_t seed);
+
+/**
+ * Random seed picked once per process, used by the std::hash specializations of byte arrays.
+ */
+uint64_t hash_seed();
+
+inline uint64_t hash_bytes(void const* data, size_t size)
+{
+    return hash_bytes(data, size, hash_seed());
+}
+
+} // arsenal namespace
@@ -8,7 +8,7 @@ namespace arsenal::debug
 /// octet_stride specifies number of bytes to print in one column
 /// octet_split causes run of bytes to be separated by extra space in given column
 /// setting it to 0 disables separation
-void hexdump(byte_array data,
+void hexdump(byte_view data,
              size_t octet_stride = 16,
              size_t octet_split = 8,
              size_t indent_spaces = 0);
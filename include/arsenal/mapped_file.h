@@ -0,0 +1,90 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <string>
+#include <boost/asio/buffer.hpp>
+#include "byte_view.h"
+
+namespace arsenal
+{
+
+/**
+ * File mapped into memory, for reading big files at page cache speed without copying them.
+ *
+ * A read_only mapping may not be written to at all. A copy_on_write mapping may, the pages
+ * written to become private to the process and never reach the file.
+ *
+ * Move it into a byte_array to pass it wherever byte_arrays go; the mapping lives as long
+ * as the byte_array or any copy or slice of it does.
+ * Failures to open or map the file throw std::system_error, and so do files that can't be
+ * mapped because they don't know their size: pipes, devices, files in /proc and /sys.
+ */
+class mapped_file
+{
+    char* data_{nullptr};
+    size_t size_{0};
+    bool writable_{false};
+
+public:
+    enum class mode {
+        read_only,
+        copy_on_write
+    };
+
+    /**
+     * Access pattern hints, passed to madvise(). They may be or-ed together and are
+     * ignored where the system does not support them.
+     */
+    enum advice : unsigned {
+        normal     = 0,
+        sequential = 1 << 0, // read ahead aggressively, drop pages behind
+        random     = 1 << 1, // don't read ahead
+        will_need  = 1 << 2, // start reading the range in now
+        huge_pages = 1 << 3, // back the mapping with transparent huge pages if possible
+    };
+
+    mapped_file() = default;
+    explicit mapped_file(std::string const& filename, mode m = mode::read_only,
+                         unsigned hints = normal);
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator = (mapped_file&& other) noexcept;
+    ~mapped_file();
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator = (mapped_file const&) = delete;
+
+    /**
+     * Change the access pattern hints for size bytes starting at offset.
+     */
+    void advise(unsigned hints, size_t offset = 0, size_t size = ~size_t(0));
+
+    /**
+     * Unmap the file, leaving this mapped_file empty.
+     */
+    void close();
+
+    inline bool is_writable() const { return writable_; }
+    inline bool is_empty() const { return size_ == 0; }
+
+    /**
+     * Writable only for copy_on_write mappings.
+     */
+    inline char* data() { return data_; }
+    inline char const* data() const { return data_; }
+    inline size_t size() const { return size_; }
+
+    inline operator byte_view() const { return byte_view(data_, size_); }
+    boost::asio::const_buffer as_buffer() const { return boost::asio::const_buffer(data_, size_); }
+
+    inline char const* begin() const { return data_; }
+    inline char const* end() const { return data_ + size_; }
+};
+
+} // arsenal namespace
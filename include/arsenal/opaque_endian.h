@@ -6,9 +6,13 @@
 // Distributed under the Boost Software License, Version 1.0.
 // (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#pragma once
+
 #include <boost/endian/arithmetic.hpp>
+#include <boost/endian/buffers.hpp>
 
-// @fixme: use boost/endian/buffer.hpp for fusionary i/o
+// Both endian arithmetic and endian buffer types keep their value in wire byte order,
+// so fusionary can copy their object representation to and from the wire as is.
 
 template <typename T>
 struct is_endian
@@ -21,3 +25,9 @@ struct is_endian<boost::endian::endian_arithmetic<O, T, N, A>>
 {
     static constexpr bool const value = true;
 };
+
+template <boost::endian::order O, typename T, std::size_t N, boost::endian::align A>
+struct is_endian<boost::endian::endian_buffer<O, T, N, A>>
+{
+    static constexpr bool const value = true;
+};
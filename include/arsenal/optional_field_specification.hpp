@@ -2,6 +2,7 @@
 
 #define BOOST_OPTIONAL_NO_INPLACE_FACTORY_SUPPORT // hmm without this breaks using optional ctor
 #include <boost/optional.hpp>
+#include <boost/mpl/int.hpp>
 
 #include <bitset>
 #include <climits>
@@ -0,0 +1,380 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/asio/buffer.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "byte_array.h"
+#include "byte_view.h"
+
+namespace arsenal
+{
+
+/**
+ * Byte array keeping up to N bytes inline, with the same interface as byte_array.
+ *
+ * Control messages and headers that fit in N bytes live entirely inside the object, on the
+ * stack or inside whatever owns it, and never touch the heap. Bigger contents spill over to
+ * a heap block. Unlike byte_array, copies and slices always copy the bytes.
+ *
+ * Converts implicitly to and from byte_array and to byte_view.
+ */
+template <size_t N>
+class small_byte_array
+{
+    static_assert(N > 0, "small_byte_array needs some inline storage");
+
+    size_t size_{0};
+    size_t capacity_{N};
+    std::unique_ptr<char[]> heap_; // null while the bytes are inline
+    char inline_[N];
+
+    inline char* storage() { return heap_ ? heap_.get() : inline_; }
+    inline char const* storage() const { return heap_ ? heap_.get() : inline_; }
+
+    // Move the bytes to a heap block of exactly capacity bytes.
+    void reallocate(size_t capacity)
+    {
+        std::unique_ptr<char[]> block(new char[capacity]);
+        std::memcpy(block.get(), storage(), size_);
+        heap_ = std::move(block);
+        capacity_ = capacity;
+    }
+
+    void grow(size_t capacity)
+    {
+        if (capacity > capacity_) {
+            reallocate(std::max(capacity, 2 * capacity_));
+        }
+    }
+
+    void assign(char const* data, size_t size)
+    {
+        grow(size);
+        if (size) {
+            std::memmove(storage(), data, size);
+        }
+        size_ = size;
+    }
+
+public:
+    using value_type = char;
+    using iterator = char*;
+    using const_iterator = char const*;
+
+    small_byte_array() {}
+    small_byte_array(small_byte_array const& other) { assign(other.data(), other.size()); }
+    small_byte_array(small_byte_array&& other) noexcept { *this = std::move(other); }
+    small_byte_array(std::string const& str) { assign(str.data(), str.size()); }
+    small_byte_array(std::vector<char> const& v) { assign(v.data(), v.size()); }
+    small_byte_array(char const* str) { assign(str, std::strlen(str) + 1); }
+    small_byte_array(char const* data, size_t size) { assign(data, size); }
+    small_byte_array(std::initializer_list<uint8_t> data)
+    {
+        grow(data.size());
+        std::copy(data.begin(), data.end(), storage());
+        size_ = data.size();
+    }
+    small_byte_array(boost::asio::const_buffer const& buf)
+    {
+        assign(boost::asio::buffer_cast<char const*>(buf), boost::asio::buffer_size(buf));
+    }
+    small_byte_array(boost::asio::mutable_buffer const& buf)
+    {
+        assign(boost::asio::buffer_cast<char const*>(buf), boost::asio::buffer_size(buf));
+    }
+    small_byte_array(byte_view const& view) { assign(view.data(), view.size()); }
+    small_byte_array(byte_array const& array) { assign(array.data(), array.size()); }
+    explicit small_byte_array(size_t size) { resize(size); }
+
+    small_byte_array& operator = (small_byte_array const& other)
+    {
+        if (&other != this) {
+            assign(other.data(), other.size());
+        }
+        return *this;
+    }
+
+    /**
+     * Never allocates: a heap block changes hands, inline bytes fit in any capacity.
+     */
+    small_byte_array& operator = (small_byte_array&& other) noexcept
+    {
+        if (&other == this) {
+            return *this;
+        }
+        if (other.heap_) {
+            heap_ = std::move(other.heap_);
+            capacity_ = other.capacity_;
+        } else if (other.size_) {
+            std::memcpy(storage(), other.inline_, other.size_);
+        }
+        size_ = other.size_;
+        other.capacity_ = N;
+        other.size_ = 0;
+        return *this;
+    }
+
+    void swap(small_byte_array& other) noexcept
+    {
+        small_byte_array temp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(temp);
+    }
+
+    inline bool is_empty() const { return size_ == 0; }
+    inline void clear() { size_ = 0; }
+
+    /**
+     * Whether the bytes are stored inline, without a heap block.
+     */
+    inline bool is_inline() const { return !heap_; }
+
+    /**
+     * @sa size(), length()
+     */
+    inline size_t capacity() const { return capacity_; }
+
+    inline char* data() { return storage(); }
+    inline const char* data() const { return storage(); }
+    inline const char* const_data() const { return storage(); }
+    /**
+     * @sa length(), capacity()
+     */
+    inline size_t size() const { return size_; }
+    /**
+     * @sa size(), capacity()
+     */
+    inline size_t length() const { return size_; }
+
+    /**
+     * Make room for at least size bytes.
+     */
+    void reserve(size_t size)
+    {
+        if (size > capacity_) {
+            reallocate(size);
+        }
+    }
+
+    /**
+     * Release unused heap capacity, moving the bytes back inline when they fit.
+     */
+    void shrink_to_fit()
+    {
+        if (!heap_) {
+            return;
+        }
+        if (size_ <= N) {
+            std::memcpy(inline_, heap_.get(), size_);
+            heap_.reset();
+            capacity_ = N;
+        } else if (capacity_ > size_) {
+            reallocate(size_);
+        }
+    }
+
+    void resize(size_t size)
+    {
+        grow(size);
+        if (size > size_) {
+            std::memset(storage() + size_, 0, size - size_);
+        }
+        size_ = size;
+    }
+
+    /**
+     * Like resize(), but leaves new bytes uninitialized.
+     */
+    void resize_uninitialized(size_t size)
+    {
+        grow(size);
+        size_ = size;
+    }
+
+    char at(int i) const
+    {
+        if (i < 0 or size_t(i) >= size_) {
+            throw std::out_of_range("small_byte_array::at");
+        }
+        return storage()[i];
+    }
+
+    inline char operator[](int i) const { return storage()[i]; }
+    inline char& operator[](int i) { return storage()[i]; }
+
+    void append(char c)
+    {
+        grow(size_ + 1);
+        storage()[size_++] = c;
+    }
+
+    void append(char const* data, size_t size)
+    {
+        if (size == 0) {
+            return;
+        }
+        // data may point into this array, copy it before growing.
+        if (size_ + size > capacity_ and data >= storage() and data < storage() + size_) {
+            small_byte_array source(data, size);
+            append(source.data(), size);
+            return;
+        }
+        grow(size_ + size);
+        std::memcpy(storage() + size_, data, size);
+        size_ += size;
+    }
+
+    void append(byte_view c) { append(c.data(), c.size()); }
+
+    /**
+     * Let writer produce up to max_size bytes directly at the end of the array,
+     * see byte_array::append_from().
+     */
+    template <typename Writer>
+    size_t append_from(size_t max_size, Writer&& writer)
+    {
+        grow(size_ + max_size);
+        size_t produced = std::min<size_t>(writer(storage() + size_, max_size), max_size);
+        size_ += produced;
+        return produced;
+    }
+
+    small_byte_array left(size_t size) const { return byte_view(*this).left(size); }
+    small_byte_array mid(int pos, size_t size = ~0) const { return byte_view(*this).mid(pos, size); }
+    small_byte_array right(size_t size) const { return byte_view(*this).right(size); }
+
+    /**
+     * Searches return the offset of the match, or npos, see byte_view.
+     */
+    static constexpr size_t npos = byte_view::npos;
+
+    size_t find(char c, size_t from = 0) const { return byte_view(*this).find(c, from); }
+    size_t find(byte_view needle, size_t from = 0) const
+    {
+        return byte_view(*this).find(needle, from);
+    }
+    size_t find_first_of(byte_view set, size_t from = 0) const
+    {
+        return byte_view(*this).find_first_of(set, from);
+    }
+    size_t count(char c) const { return byte_view(*this).count(c); }
+    bool starts_with(byte_view prefix) const { return byte_view(*this).starts_with(prefix); }
+    bool ends_with(byte_view suffix) const { return byte_view(*this).ends_with(suffix); }
+
+    /**
+     * Fill entire array to char @a ch.
+     * If the size is specified, resizes the array beforehand.
+     */
+    small_byte_array& fill(char ch, int size = -1)
+    {
+        if (size != -1) {
+            resize(size);
+        }
+        std::fill(begin(), end(), ch);
+        return *this;
+    }
+
+    template <typename T>
+    T* as() {
+        return reinterpret_cast<T*>(data());
+    }
+
+    template <typename T>
+    T const* as() const {
+        return reinterpret_cast<T const*>(data());
+    }
+
+    template <typename T>
+    T* as(size_t n) {
+        if (sizeof(T)*n > size()) {
+            resize(sizeof(T)*n);
+        }
+        return reinterpret_cast<T*>(data());
+    }
+
+    inline boost::string_ref
+    string_view(size_t start_offset, size_t count = boost::string_ref::npos) const {
+        return boost::string_ref(data(), size()).substr(start_offset, count);
+    }
+
+    std::string as_string() const { return std::string(data(), size()); }
+
+    inline operator byte_view() const { return byte_view(data(), size()); }
+
+    inline iterator begin() { return data(); }
+    inline const_iterator begin() const { return data(); }
+    inline iterator end() { return data() + size(); }
+    inline const_iterator end() const { return data() + size(); }
+};
+
+template <size_t N>
+inline void swap(small_byte_array<N>& a, small_byte_array<N>& b) noexcept { a.swap(b); }
+
+template <size_t N>
+byte_array::byte_array(small_byte_array<N> const& small)
+    : byte_array(small.data(), small.size())
+{}
+
+// Comparisons between any of the byte containers compare bytes.
+template <size_t N, size_t M>
+inline bool operator ==(small_byte_array<N> const& a, small_byte_array<M> const& b)
+{
+    return byte_view(a) == byte_view(b);
+}
+
+template <size_t N>
+inline bool operator ==(small_byte_array<N> const& a, byte_array const& b)
+{
+    return byte_view(a) == byte_view(b);
+}
+
+template <size_t N>
+inline bool operator ==(byte_array const& a, small_byte_array<N> const& b)
+{
+    return byte_view(a) == byte_view(b);
+}
+
+template <size_t N>
+inline bool operator ==(small_byte_array<N> const& a, byte_view b) { return byte_view(a) == b; }
+
+template <size_t N>
+inline bool operator ==(byte_view a, small_byte_array<N> const& b) { return a == byte_view(b); }
+
+template <size_t N, size_t M>
+inline bool operator !=(small_byte_array<N> const& a, small_byte_array<M> const& b)
+{
+    return !(a == b);
+}
+
+template <size_t N>
+inline bool operator !=(small_byte_array<N> const& a, byte_array const& b) { return !(a == b); }
+
+template <size_t N>
+inline bool operator !=(byte_array const& a, small_byte_array<N> const& b) { return !(a == b); }
+
+template <size_t N>
+inline bool operator !=(small_byte_array<N> const& a, byte_view b) { return !(a == b); }
+
+template <size_t N>
+inline bool operator !=(byte_view a, small_byte_array<N> const& b) { return !(a == b); }
+
+template <size_t N>
+inline std::ostream& operator << (std::ostream& os, small_byte_array<N> const& a)
+{
+    return os << byte_view(a);
+}
+
+} // arsenal namespace
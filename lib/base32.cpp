@@ -47,7 +47,7 @@ const char base32Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
 
 namespace arsenal::encode {
 
-std::string to_base32(const byte_array& src)
+std::string to_base32(byte_view src)
 {
     // Code snagged from the bitzi bitcollider
     size_t i, index;
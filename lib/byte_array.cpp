@@ -6,33 +6,168 @@
 // Distributed under the Boost Software License, Version 1.0.
 // (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include <atomic>
 #include <iostream>
 #include <iomanip>
+#include <cstring>
 #include "arsenal/byte_array.h"
+#include "arsenal/mapped_file.h"
 
 namespace arsenal
 {
 
+namespace {
+
+// What data() points to while nothing is stored.
+char empty_data[1] = {0};
+
+} // anonymous namespace
+
+/**
+ * Memory block holding the bytes of one or more byte_arrays.
+ * It is allocated uninitialized, byte_array zeroes new bytes where its interface says so.
+ */
+struct byte_array::storage
+{
+    char* bytes{nullptr};
+    size_t capacity{0};
+    std::pmr::memory_resource* resource{nullptr}; // null when someone else owns the bytes
+    bool read_only{false}; // the bytes may not be written to, not even by their only user
+    bool unshareable{false}; // a mutable pointer to the bytes was handed out, copies copy them
+
+    storage() = default;
+
+    storage(size_t size, std::pmr::memory_resource* r)
+        : bytes(size ? static_cast<char*>(r->allocate(size, alignof(std::max_align_t))) : nullptr)
+        , capacity(size)
+        , resource(r)
+    {}
+
+    ~storage()
+    {
+        if (bytes and resource) {
+            resource->deallocate(bytes, capacity, alignof(std::max_align_t));
+        }
+    }
+
+    storage(storage const&) = delete;
+    storage& operator = (storage const&) = delete;
+};
+
+/**
+ * Storage borrowing the buffer of a string or vector moved into it.
+ * Always held by a shared_ptr to the derived type, so no virtual destructor is needed.
+ */
+template <typename Owner>
+struct byte_array::adopted : byte_array::storage
+{
+    Owner owner;
+
+    adopted(Owner&& o)
+        : owner(std::move(o))
+    {
+        bytes = owner.data();
+        capacity = owner.size();
+    }
+
+};
+
 byte_array::byte_array()
-    : value()
 {}
 
 byte_array::byte_array(byte_array const& other)
-    : value(other.value)
+    : storage_(other.storage_)
+    , offset_(other.offset_)
+    , size_(other.size_)
+    , resource_(other.resource_)
+{
+    unshare();
+}
+
+byte_array::byte_array(byte_array&& other) noexcept
+    : storage_(std::move(other.storage_))
+    , offset_(other.offset_)
+    , size_(other.size_)
+    , resource_(other.resource_)
+{
+    other.offset_ = other.size_ = 0;
+}
+
+byte_array::byte_array(allocator_type alloc)
+    : resource_(alloc.resource())
 {}
 
+byte_array::byte_array(byte_array const& other, allocator_type alloc)
+    : resource_(alloc.resource())
+{
+    *this = other;
+}
+
+byte_array::byte_array(byte_array&& other, allocator_type alloc)
+    : resource_(alloc.resource())
+{
+    if (*resource_ == *other.resource_) {
+        swap(other);
+    } else {
+        *this = other;
+    }
+}
+
+byte_array::byte_array(const char* data, size_t size, allocator_type alloc)
+    : resource_(alloc.resource())
+{
+    if (size) {
+        memcpy(grow_uninitialized(size), data, size);
+    }
+}
+
+byte_array::byte_array(std::string const& str)
+    : byte_array(str.data(), str.size())
+{}
+
+byte_array::byte_array(std::string&& str)
+    : size_(str.size())
+{
+    if (size_) {
+        storage_ = std::allocate_shared<adopted<std::string>>(
+            std::pmr::polymorphic_allocator<char>(resource_), std::move(str));
+    }
+}
+
+byte_array::byte_array(std::vector<char>&& v)
+    : size_(v.size())
+{
+    if (size_) {
+        storage_ = std::allocate_shared<adopted<std::vector<char>>>(
+            std::pmr::polymorphic_allocator<char>(resource_), std::move(v));
+    }
+}
+
+byte_array::byte_array(mapped_file&& file)
+    : size_(file.size())
+{
+    if (size_) {
+        bool read_only = !file.is_writable();
+        storage_ = std::allocate_shared<adopted<mapped_file>>(
+            std::pmr::polymorphic_allocator<char>(resource_), std::move(file));
+        storage_->read_only = read_only;
+    }
+}
+
 byte_array::byte_array(const char* str)
-    : value(str, str+strlen(str)+1)
+    : byte_array(str, strlen(str)+1)
 {}
 
 byte_array::byte_array(const char* data, size_t size)
-    : value(data, data+size)
-{}
+{
+    if (size) {
+        memcpy(grow_uninitialized(size), data, size);
+    }
+}
 
 byte_array::byte_array(std::initializer_list<uint8_t> data)
 {
-    resize(data.size());
-    uninitialized_copy(data.begin(), data.end(), value.begin());
+    std::copy(data.begin(), data.end(), grow_uninitialized(data.size()));
 }
 
 byte_array::~byte_array()
@@ -40,91 +175,272 @@ byte_array::~byte_array()
 
 byte_array& byte_array::operator = (const byte_array& other)
 {
-    if (&other != this) {
-        value = other.value;
+    if (&other == this) {
+        return *this;
+    }
+    if (*resource_ == *other.resource_) {
+        storage_ = other.storage_;
+        offset_ = other.offset_;
+        size_ = other.size_;
+        unshare();
+    } else {
+        // Keep our resource, the bytes have to move into it.
+        byte_array source(other);
+        clear();
+        if (source.size_) {
+            memcpy(grow_uninitialized(source.size_), source.const_data(), source.size_);
+        }
     }
     return *this;
 }
 
 byte_array& byte_array::operator = (byte_array&& other)
 {
-    if (&other != this) {
-        value = std::move(other.value);
+    if (&other == this) {
+        return *this;
+    }
+    if (*resource_ != *other.resource_) {
+        // Keep our resource, the bytes have to move into it.
+        return *this = other;
     }
+    storage_ = std::move(other.storage_);
+    offset_ = other.offset_;
+    size_ = other.size_;
+    other.offset_ = other.size_ = 0;
     return *this;
 }
 
+void byte_array::swap(byte_array& other) noexcept
+{
+    storage_.swap(other.storage_);
+    std::swap(offset_, other.offset_);
+    std::swap(size_, other.size_);
+    std::swap(resource_, other.resource_);
+}
+
+bool byte_array::is_shared() const
+{
+    if (!storage_) {
+        return false;
+    }
+    if (storage_.use_count() > 1) {
+        return true;
+    }
+    // use_count() is a relaxed load. Other owners drop their reference with a release
+    // decrement, the fence orders their reads of the bytes before our writes to them.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return false;
+}
+
+void byte_array::reallocate(size_t capacity)
+{
+    auto fresh = std::allocate_shared<storage>(std::pmr::polymorphic_allocator<char>(resource_),
+                                               std::max(capacity, size_), resource_);
+    if (size_) {
+        memcpy(fresh->bytes, const_data(), size_);
+    }
+    storage_ = std::move(fresh);
+    offset_ = 0;
+}
+
+void byte_array::detach()
+{
+    if (is_shared() or storage_->read_only) {
+        reallocate(size_);
+    }
+}
+
+void byte_array::unshare()
+{
+    if (storage_ and storage_->unshareable) {
+        reallocate(size_);
+    }
+}
+
+char* byte_array::writable_data()
+{
+    if (!storage_ or !storage_->bytes) {
+        return empty_data;
+    }
+    detach();
+    // Detaching an empty slice leaves storage without bytes.
+    return storage_->bytes ? storage_->bytes + offset_ : empty_data;
+}
+
+byte_array::storage& byte_array::own(size_t capacity)
+{
+    if (!storage_ or is_shared() or storage_->read_only or offset_ != 0
+        or capacity > storage_->capacity) {
+        // Grow geometrically, so that appending byte by byte stays linear.
+        if (storage_ and !is_shared() and !storage_->read_only) {
+            capacity = std::max(capacity, 2 * (storage_->capacity - offset_));
+        }
+        reallocate(capacity);
+    }
+    return *storage_;
+}
+
+char* byte_array::grow_uninitialized(size_t size)
+{
+    size_t old_size = size_;
+    own(size_ + size);
+    size_ += size;
+    return storage_->bytes + old_size;
+}
+
+void byte_array::clear()
+{
+    if (is_shared() or (storage_ and storage_->read_only)) {
+        storage_.reset();
+    }
+    offset_ = size_ = 0; // private storage keeps its capacity
+}
+
 char* byte_array::data() {
-    return &value[0];
+    char* bytes = writable_data();
+    if (storage_) {
+        storage_->unshareable = true;
+    }
+    return bytes;
 }
 
 const char* byte_array::data() const {
-    return &value[0];
+    return storage_ and storage_->bytes ? storage_->bytes + offset_ : empty_data;
 }
 
 const char* byte_array::const_data() const {
-    return &value[0];
+    return data();
 }
 
-size_t byte_array::size() const {
-    return value.size();
+size_t byte_array::capacity() const
+{
+    return storage_ ? storage_->capacity - offset_ : 0;
+}
+
+void byte_array::reserve(size_t size)
+{
+    if (!storage_ or is_shared() or storage_->read_only or offset_ != 0
+        or size > storage_->capacity) {
+        reallocate(size);
+    }
+}
+
+void byte_array::shrink_to_fit()
+{
+    if (size_ == 0) {
+        storage_.reset();
+        offset_ = 0;
+    } else if (is_shared() or offset_ != 0 or storage_->capacity > size_) {
+        reallocate(size_);
+    }
+}
+
+void byte_array::resize(size_t size)
+{
+    size_t old_size = size_;
+    resize_uninitialized(size);
+    if (size > old_size) {
+        memset(storage_->bytes + old_size, 0, size - old_size);
+    }
+}
+
+void byte_array::resize_uninitialized(size_t size)
+{
+    if (size <= size_) {
+        size_ = size;
+        return;
+    }
+    grow_uninitialized(size - size_);
 }
 
 char byte_array::at(int i) const {
-    return value.at(i);
+    if (i < 0 or size_t(i) >= size_) {
+        throw std::out_of_range("byte_array::at");
+    }
+    return data()[i];
 }
 
 char byte_array::operator[](int i) const {
-    return value[i];
+    return data()[i];
 }
 
 char& byte_array::operator[](int i) {
-    return value[i];
+    return data()[i];
+}
+
+void byte_array::append(char c)
+{
+    *grow_uninitialized(1) = c;
+}
+
+void byte_array::append(char const* data, size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+    if (storage_ and data >= storage_->bytes and data < storage_->bytes + storage_->capacity) {
+        // Our own bytes, they may move while we grow.
+        byte_array source(data, size);
+        memcpy(grow_uninitialized(size), source.const_data(), size);
+        return;
+    }
+    memcpy(grow_uninitialized(size), data, size);
+}
+
+void byte_array::append(byte_array const& c)
+{
+    append(c.const_data(), c.size());
 }
 
 byte_array byte_array::left(size_t new_size) const
 {
-    new_size = std::min(new_size, size());
-    return byte_array(const_data(), new_size);
+    byte_array slice(*this);
+    slice.size_ = std::min(new_size, size());
+    return slice;
 }
 
 byte_array byte_array::mid(int pos, size_t new_size) const
 {
-    new_size = std::min(new_size, size() - pos);
-    return byte_array(const_data() + pos, new_size);
+    byte_array slice(*this);
+    slice.offset_ += pos;
+    slice.size_ = std::min(new_size, size() - pos);
+    return slice;
 }
 
 byte_array byte_array::right(size_t new_size) const
 {
-    new_size = std::min(new_size, size());
-    return byte_array(const_data() + size() - new_size, new_size);
+    byte_array slice(*this);
+    slice.size_ = std::min(new_size, size());
+    slice.offset_ += size() - slice.size_;
+    return slice;
 }
 
 byte_array& byte_array::fill(char ch, int size)
 {
     if (size != -1) {
-        value.resize(size);
+        resize(size);
     }
-    std::fill(value.begin(), value.end(), ch);
+    std::fill_n(writable_data(), size_, ch);
     return *this;
 }
 
-byte_array byte_array::wrap(const char* data, size_t size) {
-    return byte_array(data, size);
-}
-
 bool operator == (const byte_array& a, const byte_array& b) {
-    return a.value == b.value;
+    return byte_view(a) == byte_view(b);
 }
 
 bool operator != (const byte_array& a, const byte_array& b) {
-    return a.value != b.value;
+    return !(a == b);
 }
 
 std::ostream& operator << (std::ostream& os, byte_array const& a)
+{
+    return os << byte_view(a);
+}
+
+std::ostream& operator << (std::ostream& os, byte_view a)
 {
     for (size_t s = 0; s < a.size(); ++s) {
-        os << std::setfill('0') << std::hex << std::setw(2) << (int)(unsigned char)(a.at(s)) << ' ';
+        os << std::setfill('0') << std::hex << std::setw(2) << (int)(unsigned char)(a[s]) << ' ';
     }
     return os;
 }
@@ -0,0 +1,282 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <algorithm>
+#include <cstring>
+#include "arsenal/byte_chain.h"
+
+namespace arsenal
+{
+
+//=================================================================================================
+// segment_pool
+//=================================================================================================
+
+segment_pool::segment_pool(size_t segment_size, size_t max_free)
+    : segment_size_(segment_size)
+    , max_free_(max_free)
+{}
+
+segment_pool::~segment_pool()
+{
+    for (char* segment : free_) {
+        delete[] segment;
+    }
+}
+
+char* segment_pool::acquire()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            char* segment = free_.back();
+            free_.pop_back();
+            return segment;
+        }
+    }
+    return new char[segment_size_];
+}
+
+void segment_pool::release(char* segment)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.size() < max_free_) {
+            free_.push_back(segment);
+            return;
+        }
+    }
+    delete[] segment;
+}
+
+segment_pool& segment_pool::default_pool()
+{
+    static segment_pool pool;
+    return pool;
+}
+
+//=================================================================================================
+// byte_chain
+//=================================================================================================
+
+byte_chain::piece byte_chain::make_piece(size_t at)
+{
+    return piece{pool_->acquire(), pool_->segment_size(), at, at, true};
+}
+
+byte_chain::piece byte_chain::make_block(size_t capacity)
+{
+    if (capacity <= pool_->segment_size()) {
+        return make_piece(0);
+    }
+    return piece{new char[capacity], capacity, 0, 0, false};
+}
+
+void byte_chain::free_piece(piece const& p)
+{
+    if (p.pooled) {
+        pool_->release(p.base);
+    } else {
+        delete[] p.base;
+    }
+}
+
+byte_chain::byte_chain(byte_chain&& other)
+    : pool_(other.pool_)
+    , pieces_(std::move(other.pieces_))
+    , size_(other.size_)
+{
+    other.pieces_.clear();
+    other.size_ = 0;
+}
+
+byte_chain& byte_chain::operator = (byte_chain&& other)
+{
+    if (&other != this) {
+        clear();
+        pool_ = other.pool_;
+        pieces_ = std::move(other.pieces_);
+        size_ = other.size_;
+        other.pieces_.clear();
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+byte_chain::~byte_chain()
+{
+    clear();
+}
+
+void byte_chain::clear()
+{
+    for (auto const& p : pieces_) {
+        free_piece(p);
+    }
+    pieces_.clear();
+    size_ = 0;
+}
+
+void byte_chain::append(char const* data, size_t size)
+{
+    while (size) {
+        if (pieces_.empty() or pieces_.back().end == pieces_.back().capacity) {
+            pieces_.push_back(make_piece(0));
+        }
+        piece& p = pieces_.back();
+        size_t n = std::min(size, p.capacity - p.end);
+        std::memcpy(p.base + p.end, data, n);
+        p.end += n;
+        data += n;
+        size -= n;
+        size_ += n;
+    }
+}
+
+void byte_chain::append(byte_chain&& other)
+{
+    if (other.pool_ != pool_) {
+        // Segments go back to the pool they came from, copy them.
+        for (auto const& p : other.pieces_) {
+            append(p.base + p.begin, p.size());
+        }
+        other.clear();
+        return;
+    }
+    for (auto const& p : other.pieces_) {
+        pieces_.push_back(p);
+    }
+    size_ += other.size_;
+    other.pieces_.clear();
+    other.size_ = 0;
+}
+
+void byte_chain::prepend(char const* data, size_t size)
+{
+    // Fill segments back to front, so that consecutive prepends stay contiguous.
+    while (size) {
+        if (pieces_.empty() or pieces_.front().begin == 0) {
+            pieces_.push_front(make_piece(pool_->segment_size()));
+        }
+        piece& p = pieces_.front();
+        size_t n = std::min(size, p.begin);
+        p.begin -= n;
+        size -= n;
+        std::memcpy(p.base + p.begin, data + size, n);
+        size_ += n;
+    }
+}
+
+byte_chain byte_chain::split(size_t n)
+{
+    byte_chain head(*pool_);
+    n = std::min(n, size_);
+    while (n) {
+        piece& p = pieces_.front();
+        if (p.size() <= n) {
+            n -= p.size();
+            size_ -= p.size();
+            head.size_ += p.size();
+            head.pieces_.push_back(p);
+            pieces_.pop_front();
+        } else {
+            head.append(p.base + p.begin, n);
+            p.begin += n;
+            size_ -= n;
+            n = 0;
+        }
+    }
+    return head;
+}
+
+void byte_chain::trim_front(size_t n)
+{
+    n = std::min(n, size_);
+    size_ -= n;
+    while (n) {
+        piece& p = pieces_.front();
+        if (p.size() <= n) {
+            n -= p.size();
+            free_piece(p);
+            pieces_.pop_front();
+        } else {
+            p.begin += n;
+            n = 0;
+        }
+    }
+}
+
+void byte_chain::trim_back(size_t n)
+{
+    n = std::min(n, size_);
+    size_ -= n;
+    while (n) {
+        piece& p = pieces_.back();
+        if (p.size() <= n) {
+            n -= p.size();
+            free_piece(p);
+            pieces_.pop_back();
+        } else {
+            p.end -= n;
+            n = 0;
+        }
+    }
+}
+
+byte_view byte_chain::coalesce(size_t n)
+{
+    n = std::min(n, size_);
+    if (n == 0) {
+        return byte_view();
+    }
+    if (pieces_.front().size() < n) {
+        piece block = make_block(n);
+        while (block.end < n) {
+            piece& p = pieces_.front();
+            size_t count = std::min(p.size(), n - block.end);
+            std::memcpy(block.base + block.end, p.base + p.begin, count);
+            block.end += count;
+            p.begin += count;
+            if (p.size() == 0) {
+                free_piece(p);
+                pieces_.pop_front();
+            }
+        }
+        pieces_.push_front(block);
+    }
+    piece const& front = pieces_.front();
+    return byte_view(front.base + front.begin, n);
+}
+
+byte_chain::const_buffers_type byte_chain::buffers() const
+{
+    const_buffers_type result;
+    result.reserve(pieces_.size());
+    for (auto const& p : pieces_) {
+        result.emplace_back(p.base + p.begin, p.size());
+    }
+    return result;
+}
+
+byte_array byte_chain::to_byte_array() const
+{
+    byte_array result;
+    if (size_ == 0) {
+        return result;
+    }
+    result.append_from(size_, [this](char* out, size_t max_size) {
+        for (auto const& p : pieces_) {
+            std::memcpy(out, p.base + p.begin, p.size());
+            out += p.size();
+        }
+        return max_size;
+    });
+    return result;
+}
+
+} // arsenal namespace
@@ -0,0 +1,268 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "arsenal/byte_search.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace arsenal
+{
+
+namespace {
+
+// Needles longer than this go straight to memmem, its skip table pays off for them.
+constexpr size_t filter_max_needle = 64;
+
+// The first/last byte filter gives up once verifying candidates has cost this much
+// more than the bytes scanned so far, e.g. for "aaab" in "aaaaaaaa...".
+constexpr size_t filter_slack = 4096;
+
+inline size_t memmem_from(uint8_t const* p, size_t offset, size_t size,
+                          uint8_t const* needle, size_t needle_size)
+{
+    void const* found = memmem(p + offset, size - offset, needle, needle_size);
+    return found ? static_cast<uint8_t const*>(found) - p : no_match;
+}
+
+//=================================================================================================
+// Byte sets
+//=================================================================================================
+
+// A set of bytes as a bitmap split on the nibbles of each byte: bit (b >> 4) & 7 of
+// low[b & 15] is set for members below 0x80, and the same bit of high[b & 15] for the rest.
+// This is the layout the SSSE3 pshufb lookups want.
+struct byte_set
+{
+    alignas(16) uint8_t low[16] = {};
+    alignas(16) uint8_t high[16] = {};
+
+    byte_set(uint8_t const* set, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            uint8_t b = set[i];
+            (b < 0x80 ? low : high)[b & 15] |= 1 << ((b >> 4) & 7);
+        }
+    }
+
+    inline bool contains(uint8_t b) const
+    {
+        return (b < 0x80 ? low : high)[b & 15] & (1 << ((b >> 4) & 7));
+    }
+};
+
+size_t find_first_of_portable(uint8_t const* p, size_t size, byte_set const& set)
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (set.contains(p[i])) {
+            return i;
+        }
+    }
+    return no_match;
+}
+
+#if defined(__x86_64__)
+
+//=================================================================================================
+// SSE2 and SSSE3
+//=================================================================================================
+
+// SSE2 is part of x86-64, only the SSSE3 byte set lookup needs a CPU check.
+
+size_t find_bytes_filtered(uint8_t const* p, size_t size,
+                           uint8_t const* needle, size_t needle_size)
+{
+    __m128i const first = _mm_set1_epi8(needle[0]);
+    __m128i const last = _mm_set1_epi8(needle[needle_size - 1]);
+    size_t const candidates = size - needle_size + 1;
+    size_t verified = 0;
+    size_t i = 0;
+
+    // Positions i..i+15 match when their first and last needle bytes both do,
+    // only those are compared in full.
+    for (; i + 16 <= candidates; i += 16) {
+        auto at_head = reinterpret_cast<__m128i const*>(p + i);
+        auto at_tail = reinterpret_cast<__m128i const*>(p + i + needle_size - 1);
+        __m128i head = _mm_loadu_si128(at_head);
+        __m128i tail = _mm_loadu_si128(at_tail);
+        unsigned mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+        while (mask) {
+            size_t at = i + __builtin_ctz(mask);
+            if (memcmp(p + at + 1, needle + 1, needle_size - 2) == 0) {
+                return at;
+            }
+            mask &= mask - 1;
+            verified += needle_size;
+        }
+        if (verified > i + filter_slack) {
+            return memmem_from(p, i + 16, size, needle, needle_size);
+        }
+    }
+    return memmem_from(p, i, size, needle, needle_size);
+}
+
+__attribute__((target("ssse3")))
+size_t find_first_of_ssse3(uint8_t const* p, size_t size, byte_set const& set)
+{
+    __m128i const low = _mm_load_si128(reinterpret_cast<__m128i const*>(set.low));
+    __m128i const high = _mm_load_si128(reinterpret_cast<__m128i const*>(set.high));
+    __m128i const bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m128i const nibble = _mm_set1_epi8(0x0f);
+    __m128i const top = _mm_set1_epi8(-128);
+    __m128i const zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + i));
+        __m128i lo = _mm_and_si128(x, nibble);
+        // pshufb yields zero for indices with the top bit set, so each byte picks its row
+        // from exactly one of the two tables.
+        __m128i row = _mm_or_si128(
+            _mm_shuffle_epi8(low, _mm_or_si128(lo, _mm_and_si128(x, top))),
+            _mm_shuffle_epi8(high, _mm_or_si128(lo, _mm_andnot_si128(x, top))));
+        __m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(x, 4), nibble));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), zero)) ^ 0xffff;
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    size_t rest = find_first_of_portable(p + i, size - i, set);
+    return rest == no_match ? no_match : i + rest;
+}
+
+size_t count_matches(uint8_t const* p, size_t size, uint8_t c)
+{
+    __m128i const needle = _mm_set1_epi8(c);
+    __m128i const zero = _mm_setzero_si128();
+    size_t count = 0;
+
+    while (size >= 16) {
+        // Byte counters are summed up before they can wrap.
+        size_t blocks = min<size_t>(size / 16, 255);
+        __m128i counters = zero;
+        for (size_t b = 0; b < blocks; ++b, p += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(x, needle));
+        }
+        __m128i sums = _mm_sad_epu8(counters, zero);
+        count += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+        size -= blocks * 16;
+    }
+    for (; size; --size) {
+        count += *p++ == c;
+    }
+    return count;
+}
+
+using find_first_of_function = size_t (*)(uint8_t const*, size_t, byte_set const&);
+
+find_first_of_function select_find_first_of()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        return find_first_of_ssse3;
+    }
+    return find_first_of_portable;
+}
+
+#else
+
+size_t find_bytes_filtered(uint8_t const* p, size_t size,
+                           uint8_t const* needle, size_t needle_size)
+{
+    return memmem_from(p, 0, size, needle, needle_size);
+}
+
+size_t count_matches(uint8_t const* p, size_t size, uint8_t c)
+{
+    return std::count(p, p + size, c);
+}
+
+using find_first_of_function = size_t (*)(uint8_t const*, size_t, byte_set const&);
+
+find_first_of_function select_find_first_of()
+{
+    return find_first_of_portable;
+}
+
+#endif
+
+} // anonymous namespace
+
+size_t find_byte(void const* data, size_t size, char c)
+{
+    // memchr is vectorized by every libc worth using.
+    void const* found = size ? memchr(data, c, size) : nullptr;
+    return found ? static_cast<char const*>(found) - static_cast<char const*>(data) : no_match;
+}
+
+size_t find_bytes(void const* data, size_t size, void const* needle, size_t needle_size)
+{
+    auto p = static_cast<uint8_t const*>(data);
+    auto n = static_cast<uint8_t const*>(needle);
+    if (needle_size == 0) {
+        return 0;
+    }
+    if (needle_size > size) {
+        return no_match;
+    }
+    if (needle_size == 1) {
+        return find_byte(data, size, n[0]);
+    }
+    if (needle_size > filter_max_needle) {
+        return memmem_from(p, 0, size, n, needle_size);
+    }
+    return find_bytes_filtered(p, size, n, needle_size);
+}
+
+size_t find_first_of(void const* data, size_t size, void const* set, size_t set_size)
+{
+    static find_first_of_function const impl = select_find_first_of();
+    if (set_size == 0) {
+        return no_match;
+    }
+    if (set_size == 1) {
+        return find_byte(data, size, *static_cast<char const*>(set));
+    }
+    return impl(static_cast<uint8_t const*>(data), size,
+                byte_set(static_cast<uint8_t const*>(set), set_size));
+}
+
+size_t count_byte(void const* data, size_t size, char c)
+{
+    return count_matches(static_cast<uint8_t const*>(data), size, c);
+}
+
+bool constant_time_equal(void const* a, void const* b, size_t size)
+{
+    auto x = static_cast<uint8_t const*>(a);
+    auto y = static_cast<uint8_t const*>(b);
+    uint64_t diff = 0;
+    for (; size >= 8; size -= 8, x += 8, y += 8) {
+        uint64_t u, v;
+        memcpy(&u, x, 8);
+        memcpy(&v, y, 8);
+        diff |= u ^ v;
+        // Hide diff from the optimizer, so it can't turn the loop into an early exit.
+        __asm__("" : "+r"(diff));
+    }
+    for (; size; --size) {
+        diff |= *x++ ^ *y++;
+        __asm__("" : "+r"(diff));
+    }
+    return diff == 0;
+}
+
+} // arsenal namespace
@@ -0,0 +1,279 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "arsenal/checksum.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace arsenal
+{
+
+namespace {
+
+//=================================================================================================
+// CRC-32C arithmetic
+//=================================================================================================
+
+// Reflected Castagnoli polynomial.
+constexpr uint32_t crc32c_poly = 0x82f63b78;
+
+using crc_table = array<array<uint32_t, 256>, 8>;
+
+// Slicing-by-8 tables: table[k][b] is the CRC of byte b followed by k zero bytes.
+constexpr crc_table make_crc_table()
+{
+    crc_table table{};
+    for (uint32_t b = 0; b < 256; ++b) {
+        uint32_t crc = b;
+        for (int i = 0; i < 8; ++i) {
+            crc = crc & 1 ? (crc >> 1) ^ crc32c_poly : crc >> 1;
+        }
+        table[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; ++b) {
+        for (size_t k = 1; k < 8; ++k) {
+            table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+        }
+    }
+    return table;
+}
+
+constexpr crc_table crc_tables = make_crc_table();
+
+inline uint64_t load64(uint8_t const* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Product of two polynomials modulo the CRC polynomial, both in reflected bit order.
+uint32_t multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t product = 0;
+    for (uint32_t m = uint32_t(1) << 31; m; m >>= 1) {
+        if (a & m) {
+            product ^= b;
+        }
+        b = b & 1 ? (b >> 1) ^ crc32c_poly : b >> 1;
+    }
+    return product;
+}
+
+// x^n modulo the CRC polynomial, by repeated squaring.
+uint32_t xpowmodp(uint64_t n)
+{
+    uint32_t result = uint32_t(1) << 31; // x^0
+    uint32_t square = uint32_t(1) << 30; // x^1
+    for (; n; n >>= 1) {
+        if (n & 1) {
+            result = multmodp(square, result);
+        }
+        square = multmodp(square, square);
+    }
+    return result;
+}
+
+uint32_t crc32c_portable(uint32_t crc, uint8_t const* p, size_t size)
+{
+    for (; size and (reinterpret_cast<uintptr_t>(p) & 7); --size) {
+        crc = (crc >> 8) ^ crc_tables[0][(crc ^ *p++) & 0xff];
+    }
+    for (; size >= 8; size -= 8, p += 8) {
+        // Little-endian word, the table walk below assumes the first byte in the low bits.
+        uint64_t word = load64(p);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        word ^= crc;
+        crc = crc_tables[7][word & 0xff] ^ crc_tables[6][(word >> 8) & 0xff]
+            ^ crc_tables[5][(word >> 16) & 0xff] ^ crc_tables[4][(word >> 24) & 0xff]
+            ^ crc_tables[3][(word >> 32) & 0xff] ^ crc_tables[2][(word >> 40) & 0xff]
+            ^ crc_tables[1][(word >> 48) & 0xff] ^ crc_tables[0][word >> 56];
+    }
+    for (; size; --size) {
+        crc = (crc >> 8) ^ crc_tables[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+
+//=================================================================================================
+// SSE4.2 and PCLMULQDQ
+//=================================================================================================
+
+// The crc32 instruction has a latency of three cycles and a throughput of one per cycle,
+// so large buffers are cut into three streams checksummed side by side. The stream CRCs
+// are then merged: crc(A B) = crc(A) * x^(8 |B|) + crc(B).
+//
+// With PCLMULQDQ the multiplication is a single carry-less multiply followed by a crc32
+// instruction, which reduces the product and multiplies it by x^33 on the way, so the
+// constants are x^(8n - 33) instead of x^(8n).
+
+struct stream_block
+{
+    size_t size;
+    uint32_t shift1; // merge constant for one block
+    uint32_t shift2; // merge constant for two blocks
+};
+
+// Largest first. Only the small ones are used for packets of a few kilobytes.
+constexpr size_t stream_block_sizes[] = {8192, 1024, 128};
+
+struct stream_blocks
+{
+    array<stream_block, 3> plain;
+    array<stream_block, 3> clmul;
+
+    stream_blocks()
+    {
+        for (size_t i = 0; i < plain.size(); ++i) {
+            size_t bits = 8 * stream_block_sizes[i];
+            plain[i] = {stream_block_sizes[i], xpowmodp(bits), xpowmodp(2 * bits)};
+            clmul[i] = {stream_block_sizes[i], xpowmodp(bits - 33), xpowmodp(2 * bits - 33)};
+        }
+    }
+};
+
+stream_blocks const& blocks()
+{
+    static stream_blocks const instance;
+    return instance;
+}
+
+__attribute__((target("sse4.2,pclmul")))
+inline uint32_t shift_clmul(uint32_t crc, uint32_t constant)
+{
+    __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc), _mm_cvtsi32_si128(constant), 0);
+    return _mm_crc32_u64(0, _mm_cvtsi128_si64(product));
+}
+
+template <bool Clmul>
+__attribute__((target("sse4.2,pclmul")))
+uint32_t crc32c_hardware(uint32_t crc, uint8_t const* p, size_t size)
+{
+    for (; size and (reinterpret_cast<uintptr_t>(p) & 7); --size) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+
+    auto const& streams = Clmul ? blocks().clmul : blocks().plain;
+    for (auto const& block : streams) {
+        while (size >= 3 * block.size) {
+            uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+            uint8_t const* end = p + block.size;
+            for (; p < end; p += 8) {
+                crc0 = _mm_crc32_u64(crc0, load64(p));
+                crc1 = _mm_crc32_u64(crc1, load64(p + block.size));
+                crc2 = _mm_crc32_u64(crc2, load64(p + 2 * block.size));
+            }
+            if constexpr (Clmul) {
+                crc = shift_clmul(crc0, block.shift2) ^ shift_clmul(crc1, block.shift1) ^ crc2;
+            } else {
+                crc = multmodp(block.shift2, crc0) ^ multmodp(block.shift1, crc1) ^ crc2;
+            }
+            p += 2 * block.size;
+            size -= 3 * block.size;
+        }
+    }
+
+    uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, p += 8) {
+        crc64 = _mm_crc32_u64(crc64, load64(p));
+    }
+    crc = crc64;
+    for (; size; --size) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+using crc_function = uint32_t (*)(uint32_t, uint8_t const*, size_t);
+
+crc_function select_crc32c()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        if (__builtin_cpu_supports("pclmul")) {
+            return crc32c_hardware<true>;
+        }
+        return crc32c_hardware<false>;
+    }
+    return crc32c_portable;
+}
+
+#else
+
+using crc_function = uint32_t (*)(uint32_t, uint8_t const*, size_t);
+
+crc_function select_crc32c()
+{
+    return crc32c_portable;
+}
+
+#endif
+
+//=================================================================================================
+// Adler and Fletcher
+//=================================================================================================
+
+// Sums can be deferred this many bytes before they overflow 32 bits.
+constexpr size_t adler_block    = 5552;
+constexpr size_t fletcher_block = 5802;
+
+} // anonymous namespace
+
+uint32_t crc32c(void const* data, size_t size, uint32_t crc)
+{
+    static crc_function const impl = select_crc32c();
+    return ~impl(~crc, static_cast<uint8_t const*>(data), size);
+}
+
+uint32_t adler32(void const* data, size_t size, uint32_t adler)
+{
+    auto p     = static_cast<uint8_t const*>(data);
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (size) {
+        size_t n = size < adler_block ? size : adler_block;
+        size -= n;
+        for (; n; --n) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+uint16_t fletcher16(void const* data, size_t size, uint16_t sum)
+{
+    auto p     = static_cast<uint8_t const*>(data);
+    uint32_t a = sum & 0xff;
+    uint32_t b = sum >> 8;
+    while (size) {
+        size_t n = size < fletcher_block ? size : fletcher_block;
+        size -= n;
+        for (; n; --n) {
+            a += *p++;
+            b += a;
+        }
+        a %= 255;
+        b %= 255;
+    }
+    return static_cast<uint16_t>((b << 8) | a);
+}
+
+} // arsenal namespace
@@ -807,12 +807,21 @@ double iarchive::unpack_double()
 //=================================================================================================
 
 byte_array iarchive::unpack_blob()
+{
+    byte_array out;
+    unpack_blob(out);
+    return out;
+}
+
+// Reuses the capacity and memory resource of out.
+void iarchive::unpack_blob(byte_array& out)
 {
     uint8_t type{0};
     size_t bytes{0};
 
+    out.clear();
     if (!(is_ >> type)) {
-        return byte_array();
+        return;
         // throw eof?
         // throw decode_error("sudden eof in unpack_blob");
     }
@@ -844,16 +853,13 @@ byte_array iarchive::unpack_blob()
 
         default:
             if (is_.eof())
-                return byte_array();
+                return;
 
             throw decode_error("invalid blob tag " + to_string(type));
     }
 
-    byte_array out;
-    out.resize(bytes);
+    out.resize_uninitialized(bytes);
     unpack_raw_data(out);
-
-    return out;
 }
 
 string iarchive::unpack_string()
@@ -897,11 +903,11 @@ string iarchive::unpack_string()
             throw decode_error("invalid string tag " + to_string(type));
     }
 
-    byte_array out;
-    out.resize(bytes);
-    unpack_raw_data(out);
+    // Read straight into the string, a short read leaves zeroes.
+    string out(bytes, '\0');
+    is_.read(&out[0], bytes);
 
-    return string(out.begin(), out.end());
+    return out;
 }
 
 size_t iarchive::unpack_array_header()
@@ -966,11 +972,20 @@ size_t iarchive::unpack_map_header()
     return count;
 }
 
-// Read as many bytes as buf has in capacity.
-// This makes sure we never read into unallocated memory.
+// Read as many bytes as buf has in size.
+// This makes sure we never read into unallocated memory. buf may come uninitialized,
+// what a short read leaves out is zeroed rather than leaking old heap contents.
 void iarchive::unpack_raw_data(byte_array& buf)
 {
-    is_.read(buf.data(), buf.size());//hmm, what about using capacity()?
+    // Read in place through append_from(), which keeps buf's storage shareable.
+    size_t size = buf.size();
+    buf.resize_uninitialized(0);
+    buf.append_from(size, [this](char* out, size_t max_size) {
+        is_.read(out, max_size);
+        size_t got = is_.gcount();
+        std::fill(out + got, out + max_size, 0);
+        return max_size;
+    });
 }
 
 // Read and discard given number of bytes
@@ -1023,6 +1038,7 @@ void oarchive::save(boost::any const& value)
     if (save_any<vector<boost::any>>(value, *this)) return; // "array"
     if (save_any<vector<char>>(value, *this)) return; // "byte_array"
     if (save_any<byte_array>(value, *this)) return; // "byte_array"
+    if (save_any<byte_view>(value, *this)) return; // "byte_array"
     if (save_any<double>(value, *this)) return;
     if (save_any<float>(value, *this)) return;
     if (save_any<bool>(value, *this)) return;
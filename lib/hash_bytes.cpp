@@ -0,0 +1,128 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "arsenal/hash_bytes.h"
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace arsenal
+{
+
+namespace {
+
+//=================================================================================================
+// wyhash, final version 4 (public domain, Wang Yi)
+//=================================================================================================
+
+constexpr uint64_t secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+inline void multiply(uint64_t& a, uint64_t& b)
+{
+    unsigned __int128 r = a;
+    r *= b;
+    a = uint64_t(r);
+    b = uint64_t(r >> 64);
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b)
+{
+    multiply(a, b);
+    return a ^ b;
+}
+
+// Little-endian loads, so that hashes are the same on every platform.
+inline uint64_t load64(uint8_t const* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline uint64_t load32(uint8_t const* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+// One to three bytes.
+inline uint64_t load_short(uint8_t const* p, size_t size)
+{
+    return (uint64_t(p[0]) << 16) | (uint64_t(p[size >> 1]) << 8) | p[size - 1];
+}
+
+} // anonymous namespace
+
+uint64_t hash_bytes(void const* data, size_t size, uint64_t seed)
+{
+    auto p = static_cast<uint8_t const*>(data);
+    seed ^= mix(seed ^ secret[0], secret[1]);
+    uint64_t a, b;
+    if (size <= 16) {
+        if (size >= 4) {
+            // Two overlapping pairs of 32-bit words cover 4 to 16 bytes.
+            size_t step = (size >> 3) << 2;
+            a = (load32(p) << 32) | load32(p + step);
+            b = (load32(p + size - 4) << 32) | load32(p + size - 4 - step);
+        } else if (size > 0) {
+            a = load_short(p, size);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = size;
+        if (i > 48) {
+            // Three independent lanes keep the multipliers busy.
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed  = mix(load64(p) ^ secret[1], load64(p + 8) ^ seed);
+                seed1 = mix(load64(p + 16) ^ secret[2], load64(p + 24) ^ seed1);
+                seed2 = mix(load64(p + 32) ^ secret[3], load64(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (i > 16) {
+            seed = mix(load64(p) ^ secret[1], load64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = load64(p + i - 16);
+        b = load64(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    multiply(a, b);
+    return mix(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+uint64_t hash_seed()
+{
+    static uint64_t const seed = [] {
+        try {
+            std::random_device rd;
+            return (uint64_t(rd()) << 32) | rd();
+        } catch (std::exception const&) {
+            // No entropy source, the clock is still unknown to a remote attacker.
+            return uint64_t(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+        }
+    }();
+    return seed;
+}
+
+} // arsenal namespace
@@ -1,5 +1,5 @@
+#include <cstdio>
 #include <iostream>
-#include <boost/format.hpp>
 #include "arsenal/hexdump.h"
 
 using namespace std;
@@ -20,41 +20,54 @@ inline char printable(char c)
 
 // @todo Add formatting width
 // @todo Add lead indent printing
-void hexdump(byte_array data, size_t octet_stride, size_t octet_split, size_t indent_spaces)
+void hexdump(byte_view data, size_t octet_stride, size_t octet_split, size_t indent_spaces)
 {
+    static char const digits[] = "0123456789abcdef";
     size_t offset = 0;
     size_t remain = data.size();
-    string spaces(indent_spaces, ' ');
+
+    // Lines are formatted into one buffer and written out whole,
+    // this allocates once per dump instead of once per byte.
+    string line;
+    line.reserve(indent_spaces + 16 + 4 * octet_stride);
+    char number[16];
 
     while (remain > 0)
     {
-        cout << spaces << boost::format("%08x  ") % offset;
+        line.assign(indent_spaces, ' ');
+        snprintf(number, sizeof(number), "%08zx  ", offset);
+        line += number;
         size_t stride = remain < octet_stride ? remain : octet_stride;
 
         for(size_t i = 0; i < stride; ++i)
         {
-            cout << boost::format("%02x ") % (int)(unsigned char)(data[i+offset]);
+            auto c = (unsigned char)(data[i+offset]);
+            line += digits[c >> 4];
+            line += digits[c & 0xf];
+            line += ' ';
             if (i == octet_split - 1)
-                cout << ' ';
+                line += ' ';
         }
         if (stride < octet_stride)
         {
             if(stride < octet_split)
-                cout << ' ';
-            for(size_t i = 0; i < octet_stride - stride; ++i)
-                cout << "   ";
+                line += ' ';
+            line.append(3 * (octet_stride - stride), ' ');
         }
-        cout << " |";
+        line += " |";
         for(size_t i = 0; i < stride; ++i)
         {
-            cout << boost::format("%c") % printable(data[i+offset]);
+            line += printable(data[i+offset]);
         }
-        cout << "|" << endl;
+        line += "|\n";
+        cout << line;
 
         remain -= stride;
         offset += stride;
     }
-    cout << spaces << boost::format("%08x") % offset << endl;
+    line.assign(indent_spaces, ' ');
+    snprintf(number, sizeof(number), "%08zx", offset);
+    cout << line << number << endl;
 }
 
 } // arsenal::debug namespace
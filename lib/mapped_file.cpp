@@ -0,0 +1,141 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "arsenal/mapped_file.h"
+#include <cerrno>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace arsenal
+{
+
+namespace {
+
+[[noreturn]] void throw_errno(string const& what)
+{
+    throw system_error(errno, generic_category(), what);
+}
+
+// Closes the descriptor once the file is mapped, the mapping keeps the file open.
+struct descriptor
+{
+    int fd;
+    ~descriptor() { ::close(fd); }
+};
+
+} // anonymous namespace
+
+mapped_file::mapped_file(string const& filename, mode m, unsigned hints)
+{
+    descriptor file{::open(filename.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (file.fd < 0) {
+        throw_errno("open " + filename);
+    }
+    struct stat st;
+    if (::fstat(file.fd, &st) < 0) {
+        throw_errno("stat " + filename);
+    }
+    // Pipes and devices report a size of zero whatever they hold.
+    if (!S_ISREG(st.st_mode)) {
+        throw system_error(EINVAL, generic_category(), "not a regular file " + filename);
+    }
+    if (st.st_size == 0) {
+        // So do /proc and /sys files, which pass for regular ones, make sure it is empty.
+        char probe;
+        ssize_t n = ::read(file.fd, &probe, 1);
+        if (n < 0) {
+            throw_errno("read " + filename);
+        }
+        if (n > 0) {
+            throw system_error(EINVAL, generic_category(), "unknown size of " + filename);
+        }
+        return; // mmap refuses empty ranges
+    }
+
+    int prot = m == mode::copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* addr = ::mmap(nullptr, st.st_size, prot, MAP_PRIVATE, file.fd, 0);
+    if (addr == MAP_FAILED) {
+        throw_errno("mmap " + filename);
+    }
+    data_ = static_cast<char*>(addr);
+    size_ = st.st_size;
+    writable_ = m == mode::copy_on_write;
+    advise(hints);
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+    , writable_(std::exchange(other.writable_, false))
+{}
+
+mapped_file& mapped_file::operator = (mapped_file&& other) noexcept
+{
+    if (&other != this) {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        writable_ = std::exchange(other.writable_, false);
+    }
+    return *this;
+}
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+void mapped_file::close()
+{
+    if (data_) {
+        ::munmap(data_, size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    writable_ = false;
+}
+
+void mapped_file::advise(unsigned hints, size_t offset, size_t size)
+{
+    if (offset >= size_) {
+        return;
+    }
+    size = min(size, size_ - offset);
+    // madvise wants a page aligned start, widen the range down to its page.
+    size_t page = ::sysconf(_SC_PAGESIZE);
+    size_t skew = offset % page;
+    char* start = data_ + offset - skew;
+    size += skew;
+
+    // Hints are only hints, failing to apply one is not an error.
+    if (hints == normal) {
+        ::madvise(start, size, MADV_NORMAL);
+    }
+    if (hints & sequential) {
+        ::madvise(start, size, MADV_SEQUENTIAL);
+    }
+    if (hints & random) {
+        ::madvise(start, size, MADV_RANDOM);
+    }
+    if (hints & will_need) {
+        ::madvise(start, size, MADV_WILLNEED);
+    }
+#if defined(MADV_HUGEPAGE)
+    if (hints & huge_pages) {
+        ::madvise(start, size, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+} // arsenal namespace
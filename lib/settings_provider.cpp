@@ -126,13 +126,14 @@ settings_provider::get_byte_array(string const& key)
     if (v.empty()) {
         return byte_array();
     }
+    // Copy the bytes once, or share the stored byte_array.
     if (v.type() == typeid(string)) {
-        return boost::any_cast<string>(v);
+        return boost::any_cast<string const&>(v);
     }
     if (v.type() == typeid(vector<char>)) {
-        return boost::any_cast<vector<char>>(v);
+        return boost::any_cast<vector<char> const&>(v);
     }
-    return std::move(boost::any_cast<byte_array>(v));
+    return boost::any_cast<byte_array const&>(v);
 }
 
 } // arsenal namespace
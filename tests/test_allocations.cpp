@@ -0,0 +1,229 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE Test_allocations
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <vector>
+#include "arsenal/byte_array.h"
+#include "arsenal/flurry.h"
+#include "arsenal/hexdump.h"
+#include "arsenal/settings_provider.h"
+#include "arsenal/small_byte_array.h"
+
+using namespace std;
+using namespace arsenal;
+
+//=================================================================================================
+// Counting operator new
+//=================================================================================================
+
+namespace {
+
+size_t allocations = 0;
+
+// Number of allocations f makes.
+template <typename F>
+size_t count_allocations(F&& f)
+{
+    size_t before = allocations;
+    f();
+    return allocations - before;
+}
+
+// Output stream over a fixed buffer, it never allocates.
+struct fixed_buffer : std::streambuf
+{
+    fixed_buffer(char* data, size_t size) { setp(data, data + size); }
+    size_t size() const { return pptr() - pbase(); }
+};
+
+} // anonymous namespace
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+// Memory resources use the aligned forms.
+void* operator new(size_t size, std::align_val_t align)
+{
+    ++allocations;
+    size_t alignment = static_cast<size_t>(align);
+    if (void* p = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    free(p);
+}
+
+//=================================================================================================
+// byte_array lifecycle
+//=================================================================================================
+
+BOOST_AUTO_TEST_CASE(byte_array_moves)
+{
+    static_assert(is_nothrow_move_constructible<byte_array>::value, "byte_array move may throw");
+    // Move assignment copies between different memory resources, so it may throw, like
+    // std::pmr containers. Between arrays on the same resource it takes over the storage.
+
+    byte_array a("some bytes to move around", 25);
+    char const* bytes = a.const_data();
+
+    BOOST_CHECK_EQUAL(count_allocations([&] {
+        byte_array b(std::move(a));
+        byte_array c;
+        c = std::move(b);
+        swap(a, c);
+    }), 0u);
+    BOOST_CHECK(a.const_data() == bytes);
+
+    // Copies share the storage.
+    BOOST_CHECK_EQUAL(count_allocations([&] {
+        byte_array copy = a;
+        byte_array slice = a.mid(5, 5);
+    }), 0u);
+
+    vector<byte_array> queue;
+    queue.reserve(4);
+    BOOST_CHECK_EQUAL(count_allocations([&] {
+        queue.push_back(std::move(a));
+        queue.emplace_back(queue.back());
+    }), 0u);
+    BOOST_CHECK(queue[0].const_data() == bytes);
+}
+
+BOOST_AUTO_TEST_CASE(small_byte_array_moves)
+{
+    using small = small_byte_array<16>;
+    static_assert(is_nothrow_move_constructible<small>::value, "small_byte_array move may throw");
+    static_assert(is_nothrow_move_assignable<small>::value, "small_byte_array move may throw");
+
+    small inline_bytes("inline", 6);
+    small heap_bytes(string(100, 'h'));
+    char const* heap = heap_bytes.data();
+
+    BOOST_CHECK_EQUAL(count_allocations([&] {
+        small a(std::move(inline_bytes));
+        small b(std::move(heap_bytes));
+        swap(a, b);
+        inline_bytes = std::move(b);
+        heap_bytes = std::move(a);
+    }), 0u);
+    BOOST_CHECK(inline_bytes == byte_view("inline", 6));
+    BOOST_CHECK(heap_bytes.data() == heap);
+
+    // Growing a vector moves the elements instead of copying their heap blocks.
+    vector<small> queue(1, heap_bytes);
+    heap = queue[0].data();
+    queue.emplace_back();
+    BOOST_CHECK(queue[0].data() == heap);
+}
+
+BOOST_AUTO_TEST_CASE(byte_array_move_in)
+{
+    string text(1000, 't');
+    char const* chars = text.data();
+    byte_array from_string;
+    // One block for the shared storage header, the characters stay where they are.
+    BOOST_CHECK_EQUAL(count_allocations([&] { from_string = byte_array(std::move(text)); }), 1u);
+    BOOST_CHECK(from_string.const_data() == chars);
+    BOOST_CHECK_EQUAL(from_string.size(), 1000u);
+
+    vector<char> v(1000, 'v');
+    char const* data = v.data();
+    byte_array from_vector;
+    BOOST_CHECK_EQUAL(count_allocations([&] { from_vector = byte_array(std::move(v)); }), 1u);
+    BOOST_CHECK(from_vector.const_data() == data);
+
+    // Writing to an adopted buffer works in place, growing copies it out.
+    from_vector[0] = 'w';
+    BOOST_CHECK(from_vector.const_data() == data);
+    from_vector.append('!');
+    BOOST_CHECK(from_vector.const_data() != data);
+    BOOST_CHECK_EQUAL(from_vector.size(), 1001u);
+    BOOST_CHECK(from_vector.at(0) == 'w' and from_vector.at(1000) == '!');
+}
+
+//=================================================================================================
+// Code paths passing byte_arrays around
+//=================================================================================================
+
+BOOST_AUTO_TEST_CASE(flurry_blobs)
+{
+    byte_array blob(string(4096, 'b'));
+    char out[8192];
+    fixed_buffer buf(out, sizeof(out));
+    ostream os(&buf);
+    flurry::oarchive oa(os);
+
+    BOOST_CHECK_EQUAL(count_allocations([&] { oa << blob; }), 0u);
+
+    istringstream is(string(out, buf.size()));
+    flurry::iarchive ia(is);
+    byte_array in;
+    // Just the storage the blob is read into, its header and its bytes.
+    BOOST_CHECK_EQUAL(count_allocations([&] { ia >> in; }), 2u);
+    BOOST_CHECK(in == blob);
+}
+
+BOOST_AUTO_TEST_CASE(hexdump_lines)
+{
+    byte_array small(64), big(1024);
+    debug::hexdump(small); // warm up the console
+    // One line buffer per dump, whatever the size.
+    size_t small_count = count_allocations([&] { debug::hexdump(small); });
+    size_t big_count = count_allocations([&] { debug::hexdump(big); });
+    BOOST_CHECK_EQUAL(small_count, big_count);
+    BOOST_CHECK_EQUAL(big_count, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(settings_byte_arrays)
+{
+    auto settings = settings_provider::instance();
+    byte_array key_material(string(256, 'k'));
+    settings->set("test.key", key_material);
+
+    // The stored copy shares the bytes, only the boost::any holder is allocated.
+    BOOST_CHECK_EQUAL(count_allocations([&] { settings->set("test.key", key_material); }), 1u);
+
+    byte_array read;
+    BOOST_CHECK_EQUAL(count_allocations([&] { read = settings->get_byte_array("test.key"); }), 0u);
+    BOOST_CHECK(read.const_data() == key_material.const_data());
+
+    settings->set("test.text", string(256, 't'));
+    // Copied once into new storage.
+    BOOST_CHECK_EQUAL(count_allocations([&] { read = settings->get_byte_array("test.text"); }), 2u);
+    BOOST_CHECK(read == byte_array(string(256, 't')));
+}
@@ -10,6 +10,13 @@
 #include <boost/test/unit_test.hpp>
 
 #include "arsenal/byte_array.h"
+#include "arsenal/small_byte_array.h"
+#include <array>
+#include <memory_resource>
+#include <sstream>
+#include <thread>
+#include <set>
+#include <unordered_map>
 
 using namespace arsenal;
 
@@ -227,9 +234,14 @@ BOOST_AUTO_TEST_CASE(fill_and_resize)
     BOOST_CHECK_THROW(b.at(3), std::out_of_range);
 }
 
-// static byte_array wrap(const char* data, size_t size);
+// static byte_view wrap(const char* data, size_t size);
 BOOST_AUTO_TEST_CASE(wrap)
 {
+    char const* hello = "hello";
+    byte_view v = byte_array::wrap(hello, 5);
+    BOOST_CHECK(v.data() == hello);
+    BOOST_CHECK(v.size() == 5);
+
     byte_array b = byte_array::wrap("hello", 5);
     BOOST_CHECK(b[0] == 'h');
     BOOST_CHECK(b[1] == 'e');
@@ -246,3 +258,459 @@ BOOST_AUTO_TEST_CASE(equals_comparison)
     byte_array other("hello");
     BOOST_CHECK(hello == other);
 }
+
+// class byte_view
+BOOST_AUTO_TEST_CASE(byte_views)
+{
+    byte_array hello("hello", 5);
+    byte_view v = hello;
+    BOOST_CHECK(v.data() == hello.data());
+    BOOST_CHECK(v == hello);
+    BOOST_CHECK(hello == v);
+    BOOST_CHECK(v != byte_array("help", 4));
+    BOOST_CHECK(v.left(2) == byte_array("he", 2));
+    BOOST_CHECK(v.mid(1, 3) == byte_array("ell", 3));
+    BOOST_CHECK(v.mid(3) == byte_array("lo", 2));
+    BOOST_CHECK(v.mid(7).is_empty());
+    BOOST_CHECK(v.right(3).data() == hello.data() + 2);
+    BOOST_CHECK(v.at(4) == 'o');
+    BOOST_CHECK_THROW(v.at(5), std::out_of_range);
+    BOOST_CHECK(v.string_view(1, 2) == "el");
+    BOOST_CHECK(v.as_string() == "hello");
+
+    char buf[64] = "receive buffer";
+    byte_view received(boost::asio::buffer(buf, 7));
+    BOOST_CHECK(received.data() == buf);
+    BOOST_CHECK(received.size() == 7);
+    BOOST_CHECK(byte_array(received) == byte_array("receive", 7));
+
+    std::ostringstream os;
+    os << received.left(2);
+    BOOST_CHECK_EQUAL(os.str(), "72 65 ");
+}
+
+// Shared storage
+BOOST_AUTO_TEST_CASE(shared_slices)
+{
+    byte_array packet("header+payload", 14);
+    byte_array payload = packet.mid(7);
+    BOOST_CHECK(payload.const_data() == packet.const_data() + 7);
+    BOOST_CHECK(payload == byte_array("payload", 7));
+    BOOST_CHECK(packet.left(6).const_data() == packet.const_data());
+    BOOST_CHECK(packet.right(4).const_data() == packet.const_data() + 10);
+    BOOST_CHECK(packet.is_shared());
+    BOOST_CHECK(payload.is_shared());
+
+    byte_array copy = packet;
+    BOOST_CHECK(copy.const_data() == packet.const_data());
+}
+
+BOOST_AUTO_TEST_CASE(copy_on_write)
+{
+    byte_array packet("header+payload", 14);
+    byte_array payload = packet.mid(7);
+
+    payload[0] = 'P';
+    BOOST_CHECK(payload == byte_array("Payload", 7));
+    BOOST_CHECK(packet == byte_array("header+payload", 14));
+    BOOST_CHECK(!payload.is_shared());
+    BOOST_CHECK(!packet.is_shared());
+
+    // Growing a slice must not clobber the bytes after it in the parent.
+    byte_array header = packet.left(6);
+    header.append('!');
+    BOOST_CHECK(header == byte_array("header!", 7));
+    BOOST_CHECK(packet == byte_array("header+payload", 14));
+
+    // Shrinking only narrows the slice.
+    byte_array copy = packet;
+    copy.resize(6);
+    BOOST_CHECK(copy.const_data() == packet.const_data());
+    BOOST_CHECK(copy == byte_array("header", 6));
+
+    byte_array self("ab", 2);
+    self.append(self);
+    BOOST_CHECK(self == byte_array("abab", 4));
+}
+
+BOOST_AUTO_TEST_CASE(mutable_pointers_stop_sharing)
+{
+    byte_array packet("header+payload", 14);
+    char* p = packet.data();
+    byte_array copy = packet;
+    byte_array payload = packet.mid(7);
+    BOOST_CHECK(copy.const_data() != packet.const_data());
+    BOOST_CHECK(payload.const_data() != packet.const_data() + 7);
+    BOOST_CHECK(!packet.is_shared());
+
+    // Writes through the pointer stay in the array it came from.
+    p[0] = 'H';
+    p[7] = 'P';
+    BOOST_CHECK(packet == byte_array("Header+Payload", 14));
+    BOOST_CHECK(copy == byte_array("header+payload", 14));
+    BOOST_CHECK(payload == byte_array("payload", 7));
+
+    byte_array assigned;
+    assigned = packet;
+    BOOST_CHECK(assigned.const_data() != packet.const_data());
+    *packet.begin() = 'h';
+    BOOST_CHECK(assigned == byte_array("Header+Payload", 14));
+
+    // Copies of the copy share again, they never handed out a mutable pointer.
+    byte_array shared = copy;
+    BOOST_CHECK(shared.const_data() == copy.const_data());
+
+    // Empty slices of shared storage still hand out a valid pointer.
+    byte_array empty = copy.left(0);
+    BOOST_CHECK(empty.data() != nullptr);
+    byte_array reserved;
+    reserved.reserve(16);
+    byte_array reserved_copy = reserved;
+    BOOST_CHECK(reserved_copy.data() != nullptr);
+}
+
+// class small_byte_array
+BOOST_AUTO_TEST_CASE(small_arrays)
+{
+    small_byte_array<64> hello("hello", 5);
+    BOOST_CHECK(hello.is_inline());
+    BOOST_CHECK(hello.data() >= reinterpret_cast<char*>(&hello)
+        and hello.data() < reinterpret_cast<char*>(&hello + 1));
+    BOOST_CHECK(hello == byte_array("hello", 5));
+    BOOST_CHECK(hello.mid(1, 3) == byte_view("ell", 3));
+    BOOST_CHECK_THROW(hello.at(5), std::out_of_range);
+
+    // Interop both ways.
+    byte_array array = hello;
+    BOOST_CHECK(array == hello);
+    small_byte_array<64> back = array;
+    BOOST_CHECK(back == hello);
+    byte_view view = hello;
+    BOOST_CHECK(view.data() == hello.data());
+
+    small_byte_array<8> grown("12345678", 8);
+    BOOST_CHECK(grown.is_inline());
+    grown.append('9');
+    BOOST_CHECK(!grown.is_inline());
+    grown.append(grown.data(), grown.size());
+    BOOST_CHECK(grown == byte_view("123456789123456789", 18));
+
+    small_byte_array<8> moved = std::move(grown);
+    BOOST_CHECK_EQUAL(moved.size(), 18u);
+    BOOST_CHECK(grown.is_empty());
+
+    moved.resize(20);
+    BOOST_CHECK(moved[19] == 0);
+    moved.fill('x', 4);
+    BOOST_CHECK(moved == byte_array("xxxx", 4));
+}
+
+// Receive-buffer code written once for any of the byte arrays.
+template <typename Bytes>
+void fill_receive_buffer(Bytes& buf)
+{
+    buf.reserve(32);
+    BOOST_CHECK_GE(buf.capacity(), 32u);
+    buf.resize_uninitialized(4);
+    std::memcpy(buf.data(), "head", 4);
+    size_t n = buf.append_from(16, [](char* spare, size_t) {
+        std::memcpy(spare, "payload", 7);
+        return 7;
+    });
+    BOOST_CHECK_EQUAL(n, 7u);
+    BOOST_CHECK(buf == byte_view("headpayload", 11));
+    buf.shrink_to_fit();
+    BOOST_CHECK(buf == byte_view("headpayload", 11));
+}
+
+BOOST_AUTO_TEST_CASE(receive_buffer_interface)
+{
+    byte_array array;
+    fill_receive_buffer(array);
+    BOOST_CHECK_EQUAL(array.capacity(), 11u);
+
+    small_byte_array<16> small;
+    fill_receive_buffer(small);
+    BOOST_CHECK(small.is_inline());
+    BOOST_CHECK_EQUAL(small.capacity(), 16u);
+
+    small_byte_array<4> spilled;
+    fill_receive_buffer(spilled);
+    BOOST_CHECK(!spilled.is_inline());
+    BOOST_CHECK_EQUAL(spilled.capacity(), 11u);
+}
+
+// uint64_t hash_bytes(void const* data, size_t size, uint64_t seed);
+BOOST_AUTO_TEST_CASE(hashing)
+{
+    char key[4096];
+    for (size_t i = 0; i < sizeof(key); ++i) {
+        key[i] = char(i * 13);
+    }
+
+    // Reference values of wyhash final version 4, seeded with the index.
+    char const* vectors[] = {"", "a", "abc", "message digest", "abcdefghijklmnopqrstuvwxyz"};
+    uint64_t expected[] = {0x93228a4de0eec5a2, 0xc5bac3db178713c4, 0xa97f2f7b1d9b3314,
+                           0x786d1f1df3801df4, 0xdca5a8138ad37c87};
+    for (size_t i = 0; i < 5; ++i) {
+        BOOST_CHECK_EQUAL(hash_bytes(vectors[i], strlen(vectors[i]), i), expected[i]);
+    }
+
+    // Every length goes through a different load pattern, each must see all of its bytes.
+    std::set<uint64_t> hashes;
+    for (size_t size : {0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 32, 48, 49, 96, 97, 4096}) {
+        uint64_t h = hash_bytes(key, size, 1);
+        BOOST_CHECK_EQUAL(h, hash_bytes(key, size, 1));
+        BOOST_CHECK(h != hash_bytes(key, size, 2));
+        BOOST_CHECK(hashes.insert(h).second);
+        for (size_t i = 0; i < size; ++i) {
+            key[i] ^= 1;
+            BOOST_CHECK(hash_bytes(key, size, 1) != h);
+            key[i] ^= 1;
+        }
+    }
+
+    byte_array peer_id(key, 32);
+    BOOST_CHECK_EQUAL(std::hash<byte_array>()(peer_id), std::hash<byte_view>()(peer_id));
+    BOOST_CHECK_EQUAL(std::hash<byte_array>()(peer_id), hash_bytes(key, 32));
+
+    std::unordered_map<byte_array, int> sessions;
+    sessions[peer_id] = 1;
+    sessions[byte_array(key + 32, 32)] = 2;
+    BOOST_CHECK_EQUAL(sessions[byte_array(key, 32)], 1);
+    BOOST_CHECK_EQUAL(sessions.size(), 2u);
+}
+
+// Capacity management
+BOOST_AUTO_TEST_CASE(capacity_and_reserve)
+{
+    byte_array buf;
+    BOOST_CHECK_EQUAL(buf.capacity(), 0u);
+    buf.reserve(1024);
+    BOOST_CHECK(buf.capacity() >= 1024);
+    BOOST_CHECK(buf.is_empty());
+
+    char const* storage = buf.const_data();
+    buf.resize_uninitialized(1000);
+    BOOST_CHECK_EQUAL(buf.size(), 1000u);
+    BOOST_CHECK(buf.const_data() == storage);
+
+    buf.clear();
+    BOOST_CHECK(buf.capacity() >= 1024); // private storage is kept for the next read
+    buf.append('x');
+    BOOST_CHECK(buf.const_data() == storage);
+
+    buf.resize(4);
+    BOOST_CHECK(buf == byte_array({'x', 0, 0, 0}));
+    buf.shrink_to_fit();
+    BOOST_CHECK_EQUAL(buf.capacity(), 4u);
+    BOOST_CHECK(buf == byte_array({'x', 0, 0, 0}));
+
+    // A small slice can let go of its big parent.
+    byte_array big(4096);
+    byte_array slice = big.mid(100, 10);
+    slice.shrink_to_fit();
+    BOOST_CHECK(!big.is_shared());
+    BOOST_CHECK_EQUAL(slice.capacity(), 10u);
+}
+
+BOOST_AUTO_TEST_CASE(append_from_writer)
+{
+    byte_array buf("head", 4);
+    size_t produced = buf.append_from(100, [](char* spare, size_t max_size) {
+        BOOST_CHECK_EQUAL(max_size, 100u);
+        memcpy(spare, "body", 4);
+        return 4;
+    });
+    BOOST_CHECK_EQUAL(produced, 4u);
+    BOOST_CHECK(buf == byte_array("headbody", 8));
+    BOOST_CHECK(buf.capacity() >= 104);
+
+    // Writing into a shared array leaves the other copy alone.
+    byte_array copy = buf;
+    buf.append_from(1, [](char* spare, size_t) { *spare = '!'; return 1; });
+    BOOST_CHECK(buf == byte_array("headbody!", 9));
+    BOOST_CHECK(copy == byte_array("headbody", 8));
+}
+
+// Memory resources
+BOOST_AUTO_TEST_CASE(memory_resources)
+{
+    std::array<char, 4096> space;
+    std::pmr::monotonic_buffer_resource arena(space.data(), space.size(),
+                                              std::pmr::null_memory_resource());
+    auto in_arena = [&](byte_array const& a) {
+        return a.const_data() >= space.data() and a.const_data() < space.data() + space.size();
+    };
+
+    byte_array scratch(&arena);
+    scratch.append("request ", 8);
+    scratch.append(byte_array("scratch", 7));
+    BOOST_CHECK(scratch == byte_array("request scratch", 15));
+    BOOST_CHECK(in_arena(scratch));
+    BOOST_CHECK(scratch.get_allocator().resource() == &arena);
+
+    // Slices and copies share the arena storage, writing to them stays in the arena.
+    byte_array word = scratch.mid(8);
+    word[0] = 'S';
+    BOOST_CHECK(in_arena(word));
+    BOOST_CHECK(scratch == byte_array("request scratch", 15));
+
+    // Assignment keeps the resource of the target.
+    byte_array heap = scratch;
+    BOOST_CHECK(in_arena(heap));
+    byte_array plain;
+    plain = scratch;
+    BOOST_CHECK(!in_arena(plain));
+    BOOST_CHECK(plain == scratch);
+    byte_array other(byte_view("x", 1), &arena);
+    other = plain;
+    BOOST_CHECK(in_arena(other));
+    other = std::move(plain);
+    BOOST_CHECK(in_arena(other));
+    BOOST_CHECK(other.get_allocator().resource() == &arena);
+    BOOST_CHECK(other == scratch);
+
+    // Allocator-extended copies, as used by pmr containers.
+    std::pmr::vector<byte_array> queue(&arena);
+    queue.push_back(plain);
+    queue.emplace_back("abc", 3);
+    BOOST_CHECK(in_arena(queue[0]));
+    BOOST_CHECK(in_arena(queue[1]));
+}
+
+BOOST_AUTO_TEST_CASE(move_between_arenas)
+{
+    std::array<char, 1024> first_space, second_space;
+    std::pmr::monotonic_buffer_resource first(first_space.data(), first_space.size(),
+                                              std::pmr::null_memory_resource());
+    std::pmr::monotonic_buffer_resource second(second_space.data(), second_space.size(),
+                                               std::pmr::null_memory_resource());
+    auto in = [](std::array<char, 1024> const& space, byte_array const& a) {
+        return a.const_data() >= space.data() and a.const_data() < space.data() + space.size();
+    };
+
+    // Move assignment keeps the resource of the target and copies into it.
+    byte_array a(byte_view("first", 5), &first);
+    byte_array b(byte_view("second", 6), &second);
+    a = std::move(b);
+    BOOST_CHECK(a == byte_array("second", 6));
+    BOOST_CHECK(a.get_allocator().resource() == &first);
+    BOOST_CHECK(in(first_space, a));
+
+    // Same resource, the storage is taken over.
+    byte_array c(byte_view("third", 5), &first);
+    char const* bytes = c.const_data();
+    a = std::move(c);
+    BOOST_CHECK(a.const_data() == bytes);
+    BOOST_CHECK(c.is_empty());
+
+    // A default-heap array stays on the heap.
+    byte_array heap("heap", 4);
+    heap = std::move(a);
+    BOOST_CHECK(heap.get_allocator().resource() == std::pmr::get_default_resource());
+    BOOST_CHECK(!in(first_space, heap));
+    BOOST_CHECK(heap == byte_array("third", 5));
+}
+
+BOOST_AUTO_TEST_CASE(search)
+{
+    // Long enough for the vector loops, with matches on both sides of a block boundary.
+    std::string text(1000, '.');
+    text.replace(15, 5, "GET /");
+    text.replace(517, 4, "\r\n\r\n");
+    text[999] = '\xff';
+    byte_array data(text);
+
+    BOOST_CHECK_EQUAL(data.find('G'), 15u);
+    BOOST_CHECK_EQUAL(data.find('G', 16), byte_array::npos);
+    BOOST_CHECK_EQUAL(data.find('\xff'), 999u);
+    BOOST_CHECK_EQUAL(data.find('x'), byte_array::npos);
+    BOOST_CHECK_EQUAL(data.find('.', 5000), byte_array::npos);
+
+    BOOST_CHECK_EQUAL(data.find(byte_view("\r\n\r\n", 4)), 517u);
+    BOOST_CHECK_EQUAL(data.find(byte_view("\r\n\r\n", 4), 518), byte_array::npos);
+    BOOST_CHECK_EQUAL(data.find(byte_view("GET /", 5)), 15u);
+    BOOST_CHECK_EQUAL(data.find(byte_view()), 0u);
+    BOOST_CHECK_EQUAL(data.find(byte_view(text.data() + 900, 100)), 900u);
+    BOOST_CHECK_EQUAL(data.find(byte_view("..\xff", 3)), 997u);
+    BOOST_CHECK_EQUAL(data.find(byte_view("..x", 3)), byte_array::npos);
+
+    BOOST_CHECK_EQUAL(data.find_first_of(byte_view("\r\n", 2)), 517u);
+    BOOST_CHECK_EQUAL(data.find_first_of(byte_view("/\r", 2)), 19u);
+    BOOST_CHECK_EQUAL(data.find_first_of(byte_view("\x80\xff", 2)), 999u);
+    BOOST_CHECK_EQUAL(data.find_first_of(byte_view("xyz", 3)), byte_array::npos);
+    BOOST_CHECK_EQUAL(data.find_first_of(byte_view()), byte_array::npos);
+
+    BOOST_CHECK_EQUAL(data.count('\n'), 2u);
+    BOOST_CHECK_EQUAL(data.count('.'), 1000u - 10);
+    BOOST_CHECK(data.starts_with(byte_view(text.data(), 20)));
+    BOOST_CHECK(!data.starts_with(byte_view("GET", 3)));
+    BOOST_CHECK(data.ends_with(byte_view(".\xff", 2)));
+    BOOST_CHECK(data.starts_with(byte_view()) and data.ends_with(byte_view()));
+    BOOST_CHECK(!byte_view().starts_with(byte_view("a", 1)));
+}
+
+BOOST_AUTO_TEST_CASE(search_matches_naive)
+{
+    // Same results as std::string, whose npos byte_view::npos equals.
+    std::string text;
+    for (int i = 0; i < 4000; ++i) {
+        text += char(i % 7 == 0 ? i / 7 : 'a');
+    }
+    byte_view data(text);
+    for (int b = 0; b < 256; ++b) {
+        char c = char(b);
+        BOOST_CHECK_EQUAL(data.find(c), text.find(c));
+        BOOST_CHECK_EQUAL(data.count(c), size_t(std::count(text.begin(), text.end(), c)));
+        std::string set{char(b), char(255 - b), '\x01'};
+        BOOST_CHECK_EQUAL(data.find_first_of(byte_view(set)), text.find_first_of(set));
+    }
+    for (size_t n : {2, 3, 16, 17, 40, 65, 200}) {
+        for (std::string needle : {text.substr(3000, n - 1) + '~', text.substr(2000 + n, n)}) {
+            BOOST_CHECK_EQUAL(data.find(byte_view(needle)), text.find(needle));
+        }
+    }
+    // Mostly false positives for the first/last byte filter.
+    std::string as(100000, 'a');
+    BOOST_CHECK_EQUAL(byte_view(as).find(byte_view("aaaaaaab", 8)), byte_view::npos);
+    as += "aaaaaaab";
+    BOOST_CHECK_EQUAL(byte_view(as).find(byte_view("aaaaaaab", 8)), 100000u);
+}
+
+BOOST_AUTO_TEST_CASE(constant_time_compare)
+{
+    byte_array key(std::string(37, 'k'));
+    byte_array same(key.as_string());
+    byte_array other(key.as_string());
+    other[36] = 'K';
+
+    BOOST_CHECK(constant_time_equal(key, same));
+    BOOST_CHECK(!constant_time_equal(key, other));
+    BOOST_CHECK(!constant_time_equal(key, key.left(36)));
+    BOOST_CHECK(constant_time_equal(byte_view(), byte_view()));
+    other = same;
+    other[0] = 0;
+    BOOST_CHECK(!constant_time_equal(key, other));
+}
+
+BOOST_AUTO_TEST_CASE(slice_handed_to_thread)
+{
+    byte_array original(std::string(4096, 'a'));
+    char const* bytes = original.const_data();
+    size_t sum = 0;
+    {
+        std::thread reader([slice = original.mid(1024, 2048), &sum] {
+            for (char c : byte_view(slice)) {
+                sum += c;
+            }
+        });
+        reader.join();
+    }
+    // The thread dropped its slice, the bytes are ours again and written in place.
+    BOOST_CHECK(!original.is_shared());
+    original[0] = 'b';
+    BOOST_CHECK_EQUAL(original.const_data(), bytes);
+    BOOST_CHECK_EQUAL(sum, 2048u * 'a');
+    BOOST_CHECK_EQUAL(original[0], 'b');
+}
@@ -0,0 +1,121 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE Test_byte_chain
+#include <boost/test/unit_test.hpp>
+
+#include "arsenal/byte_chain.h"
+#include "arsenal/byte_array_wrap.h"
+#include "arsenal/flurry.h"
+
+using namespace std;
+using namespace arsenal;
+
+namespace {
+
+// Bytes 0, 1, 2... so misplaced pieces show up.
+string sequence(size_t size)
+{
+    string s(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        s[i] = char(i * 7);
+    }
+    return s;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(append_and_prepend)
+{
+    segment_pool pool(16);
+    byte_chain chain(pool);
+    BOOST_CHECK(chain.is_empty());
+
+    string body = sequence(100);
+    chain.append(body);
+    BOOST_CHECK_EQUAL(chain.size(), 100u);
+    BOOST_CHECK_EQUAL(chain.segments(), 7u);
+
+    chain.prepend(byte_view("head", 4));
+    chain.prepend(byte_view("er:", 3));
+    chain.append('!');
+    BOOST_CHECK_EQUAL(chain.segments(), 8u); // both prepends went into one segment
+    BOOST_CHECK(chain.to_byte_array() == byte_view("er:head" + body + "!"));
+
+    size_t total = 0;
+    for (auto const& b : chain.buffers()) {
+        total += boost::asio::buffer_size(b);
+    }
+    BOOST_CHECK_EQUAL(total, chain.size());
+    BOOST_CHECK_EQUAL(boost::asio::buffer_size(chain.buffers()), chain.size());
+}
+
+BOOST_AUTO_TEST_CASE(split_and_trim)
+{
+    segment_pool pool(16);
+    byte_chain chain(pool);
+    string body = sequence(50);
+    chain.append(body);
+
+    byte_chain head = chain.split(20); // through the middle of the second segment
+    BOOST_CHECK(head.to_byte_array() == byte_view(body.substr(0, 20)));
+    BOOST_CHECK(chain.to_byte_array() == byte_view(body.substr(20)));
+
+    head.append(std::move(chain));
+    BOOST_CHECK(chain.is_empty());
+    BOOST_CHECK(head.to_byte_array() == byte_view(body));
+
+    head.trim_front(17);
+    head.trim_back(3);
+    BOOST_CHECK(head.to_byte_array() == byte_view(body.substr(17, 30)));
+
+    byte_chain all = head.split(1000);
+    BOOST_CHECK(head.is_empty());
+    BOOST_CHECK_EQUAL(all.size(), 30u);
+}
+
+BOOST_AUTO_TEST_CASE(coalesce)
+{
+    segment_pool pool(16);
+    byte_chain chain(pool);
+    string body = sequence(40);
+    chain.append(body);
+
+    byte_view first = chain.coalesce(10);
+    BOOST_CHECK(first == byte_view(body.substr(0, 10))); // already contiguous
+
+    byte_view header = chain.coalesce(24);
+    BOOST_CHECK(header == byte_view(body.substr(0, 24)));
+    BOOST_CHECK(chain.to_byte_array() == byte_view(body));
+
+    byte_view flat = chain.coalesce();
+    BOOST_CHECK(flat == byte_view(body));
+    BOOST_CHECK_EQUAL(chain.segments(), 1u);
+
+    chain.append(byte_view("tail", 4));
+    BOOST_CHECK(chain.to_byte_array() == byte_view(body + "tail"));
+}
+
+BOOST_AUTO_TEST_CASE(serialize_into_chain)
+{
+    byte_chain chain;
+    string big(10000, 'x');
+    {
+        byte_array_owrap<flurry::oarchive, byte_chain> write(chain);
+        write.archive() << big << uint32_t(42);
+    }
+    BOOST_CHECK(chain.segments() > 1);
+
+    byte_array data = chain.to_byte_array();
+    string out_str;
+    uint32_t out_u32;
+    byte_array_iwrap<flurry::iarchive> read(data);
+    read.archive() >> out_str >> out_u32;
+    BOOST_CHECK(out_str == big);
+    BOOST_CHECK_EQUAL(out_u32, 42u);
+}
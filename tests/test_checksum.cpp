@@ -0,0 +1,79 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE Test_checksum
+#include <boost/test/unit_test.hpp>
+
+#include "arsenal/checksum.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace arsenal;
+
+BOOST_AUTO_TEST_CASE(check_values)
+{
+    string digits = "123456789";
+    BOOST_CHECK_EQUAL(crc32c(digits.data(), digits.size()), 0xe3069283u);
+    BOOST_CHECK_EQUAL(crc32c(nullptr, 0), 0u);
+    BOOST_CHECK_EQUAL(adler32("Wikipedia", 9), 0x11e60398u);
+    BOOST_CHECK_EQUAL(fletcher16("abcde", 5), 0xc8f0);
+    BOOST_CHECK_EQUAL(fletcher16("abcdef", 6), 0x2057);
+
+    // 32 bytes of zeros, RFC 3720 appendix B.4.
+    vector<uint8_t> zeros(32, 0);
+    BOOST_CHECK_EQUAL(crc32c(zeros.data(), zeros.size()), 0x8a9136aau);
+}
+
+// Reference bit-at-a-time CRC-32C.
+uint32_t crc32c_bitwise(uint8_t const* p, size_t size)
+{
+    uint32_t crc = ~0u;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+BOOST_AUTO_TEST_CASE(crc32c_all_sizes_and_offsets)
+{
+    vector<uint8_t> data(80 * 1024);
+    uint32_t seed = 1;
+    for (auto& b : data) {
+        seed = seed * 1103515245 + 12345;
+        b    = seed >> 24;
+    }
+
+    // Sizes around every stream block boundary, at unaligned starts.
+    for (size_t size : {0, 1, 7, 8, 63, 64, 383, 384, 385, 1000, 3071, 3072, 3080, 24575, 24576,
+                        24583, 65536, 80 * 1024 - 3}) {
+        for (size_t offset : {0, 1, 3}) {
+            if (offset + size > data.size()) {
+                continue;
+            }
+            BOOST_CHECK_EQUAL(crc32c(data.data() + offset, size),
+                              crc32c_bitwise(data.data() + offset, size));
+        }
+    }
+
+    // Checksumming in pieces gives the same result.
+    uint32_t crc = crc32c(data.data(), 1000);
+    crc = crc32c(data.data() + 1000, data.size() - 1000, crc);
+    BOOST_CHECK_EQUAL(crc, crc32c(data.data(), data.size()));
+
+    uint32_t adler = adler32(data.data(), 7000);
+    adler = adler32(data.data() + 7000, data.size() - 7000, adler);
+    BOOST_CHECK_EQUAL(adler, adler32(data.data(), data.size()));
+
+    uint16_t fletcher = fletcher16(data.data(), 7000);
+    fletcher = fletcher16(data.data() + 7000, data.size() - 7000, fletcher);
+    BOOST_CHECK_EQUAL(fletcher, fletcher16(data.data(), data.size()));
+}
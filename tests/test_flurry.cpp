@@ -107,3 +107,41 @@ BOOST_AUTO_TEST_CASE(serialize_mismatch)
         read.archive() >> out_u8_1;
     }, flurry::decode_error);
 }
+
+BOOST_AUTO_TEST_CASE(serialize_byte_view)
+{
+    char const raw[] = "raw receive buffer";
+    byte_array data;
+    {
+        byte_array_owrap<flurry::oarchive> write(data);
+        write.archive() << byte_view(raw, 3) << byte_array(raw, 3);
+    }
+    byte_array from_view, from_array;
+    {
+        byte_array_iwrap<flurry::iarchive> read(data);
+        read.archive() >> from_view >> from_array;
+    }
+    BOOST_CHECK(from_view == byte_array(raw, 3));
+    BOOST_CHECK(from_view == from_array);
+}
+
+BOOST_AUTO_TEST_CASE(deserialize_into_arena)
+{
+    byte_array data;
+    {
+        byte_array_owrap<flurry::oarchive> write(data);
+        write.archive() << byte_array(string(100, 'a')) << byte_array(string(200, 'b'));
+    }
+
+    char space[1024];
+    std::pmr::monotonic_buffer_resource arena(space, sizeof(space), std::pmr::null_memory_resource());
+    byte_array first(&arena), second(&arena);
+    {
+        byte_array_iwrap<flurry::iarchive> read(data);
+        read.archive() >> first >> second;
+    }
+    BOOST_CHECK(first == byte_array(string(100, 'a')));
+    BOOST_CHECK(second == byte_array(string(200, 'b')));
+    BOOST_CHECK(second.const_data() >= space and second.const_data() < space + sizeof(space));
+    BOOST_CHECK(first.get_allocator().resource() == &arena);
+}
@@ -3,6 +3,12 @@
 
 #include <boost/endian/arithmetic.hpp>
 #include "arsenal/fusionary.hpp"
+#include "arsenal/fusionary/batch.hpp"
+#include "arsenal/fusionary/delta.hpp"
+#include "arsenal/fusionary/dispatcher.hpp"
+#include "arsenal/fusionary/gather_writer.hpp"
+#include "arsenal/fusionary/packet_builder.hpp"
+#include "arsenal/fusionary/view.hpp"
 #include "arsenal/optional_field_specification.hpp"
 
 #include <iostream>
@@ -165,3 +171,938 @@ BOOST_AUTO_TEST_CASE(endians_check)
         BOOST_REQUIRE_EQUAL(i, j);
     }
 }
+
+using magic_t = std::integral_constant<uint8_t, 0xab>;
+using ids_t = std::array<big_uint32_t, 2>;
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), fixed_header,
+    (magic_t, magic)
+    (field_flag<uint8_t>, flags)
+    (big_uint16_t, length)
+    (ids_t, ids)
+);
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), prefixed_packet,
+    (fixed_header, header)
+    (uint32_t, sequence)
+    (std::string, name)
+    (fusionary::rest_t, body)
+);
+
+BOOST_AUTO_TEST_CASE(static_sizes)
+{
+    static_assert(fusionary::static_size<uint32_t> == 4);
+    static_assert(fusionary::static_size<big_uint16_t> == 2);
+    static_assert(fusionary::static_size<field_flag<uint8_t>> == 1);
+    static_assert(fusionary::static_size<fixed_header> == 12);
+    static_assert(fusionary::is_fixed_size<fixed_header>);
+    static_assert(!fusionary::is_fixed_size<prefixed_packet>);
+    static_assert(!fusionary::is_fixed_size<test_optional_field_struct>);
+    static_assert(fusionary::fixed_prefix_size<prefixed_packet> == 16);
+    static_assert(fusionary::fixed_prefix_size<test_optional_field_struct> == 1);
+}
+
+BOOST_AUTO_TEST_CASE(bounds_checked_read_write)
+{
+    prefixed_packet p;
+    p.header.flags.value = 3;
+    p.header.length = 0x1234;
+    p.header.ids = {{1, 2}};
+    p.sequence = 42;
+    p.name = "name";
+    p.body = "body";
+
+    std::array<char, 64> b;
+    auto rest = fusionary::write(mutable_buffer(b.data(), b.size()), p);
+    size_t size = b.size() - buffer_size(rest);
+    BOOST_CHECK_EQUAL(size, 16 + 2 + 4 + 4);
+
+    prefixed_packet r;
+    fusionary::read(r, const_buffer(b.data(), size));
+    BOOST_CHECK_EQUAL(r.header.flags.value, 3);
+    BOOST_CHECK_EQUAL(r.header.length, 0x1234);
+    BOOST_CHECK(r.header.ids == p.header.ids);
+    BOOST_CHECK_EQUAL(r.sequence, 42u);
+    BOOST_CHECK_EQUAL(r.name, "name");
+    BOOST_CHECK_EQUAL(r.body.data, "body");
+
+    // Truncated anywhere in the fixed prefix, in the string length or in the string itself.
+    for (size_t cut : {0, 5, 15, 17, 20}) {
+        prefixed_packet t;
+        BOOST_CHECK_THROW(fusionary::read(t, const_buffer(b.data(), cut)),
+                          fusionary::buffer_overrun);
+    }
+
+    BOOST_CHECK_THROW(fusionary::write(mutable_buffer(b.data(), 10), p), fusionary::buffer_overrun);
+    BOOST_CHECK_THROW(fusionary::write(mutable_buffer(b.data(), 20), p), fusionary::buffer_overrun);
+}
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), ordered_header,
+    (uint8_t, type)
+    (fusionary::big<uint32_t>, length)
+    (fusionary::little<uint16_t>, port)
+    (big_uint16_buf_t, checksum)
+);
+
+BOOST_AUTO_TEST_CASE(unaligned_endian_fields)
+{
+    std::array<uint8_t, 16> b{};
+    ordered_header h;
+    h.type = 7;
+    h.length = 0x01020304;
+    h.port = 0x0506;
+    h.checksum = big_uint16_buf_t(0x0708);
+
+    // Offset by one byte so none of the multibyte fields is aligned.
+    fusionary::write(mutable_buffer(b.data() + 1, 9), h);
+    std::array<uint8_t, 16> expected{{0, 7, 1, 2, 3, 4, 6, 5, 7, 8}};
+    BOOST_CHECK(b == expected);
+
+    ordered_header r;
+    fusionary::read(r, const_buffer(b.data() + 1, 9));
+    BOOST_CHECK_EQUAL(r.type, 7);
+    BOOST_CHECK_EQUAL(r.length, 0x01020304u);
+    BOOST_CHECK_EQUAL(r.port, 0x0506);
+    BOOST_CHECK_EQUAL(r.checksum.value(), 0x0708);
+}
+
+using peer_id_t = std::array<uint8_t, 4>;
+using samples_t = fusionary::big_vector<uint32_t>;
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), block_fields,
+    (peer_id_t, peer)
+    (std::vector<uint16_t>, native)
+    (std::vector<big_uint16_t>, ordered)
+    (samples_t, samples)
+);
+
+BOOST_AUTO_TEST_CASE(block_vectors_and_arrays)
+{
+    block_fields f;
+    f.peer = {{1, 2, 3, 4}};
+    f.native = {0x0102, 0x0304};
+    f.ordered = {0x0506, 0x0708};
+    f.samples = {0x090a0b0c, 0x0d0e0f10};
+
+    std::array<uint8_t, 32> b{};
+    auto rest = fusionary::write(mutable_buffer(b.data(), b.size()), f);
+    size_t size = b.size() - buffer_size(rest);
+    BOOST_REQUIRE_EQUAL(size, 4 + 2 + 4 + 2 + 4 + 2 + 8);
+
+    // Samples are big-endian on the wire, regardless of host order.
+    std::array<uint8_t, 10> samples{{2, 0, 9, 10, 11, 12, 13, 14, 15, 16}};
+    BOOST_CHECK(std::equal(samples.begin(), samples.end(), b.begin() + 16));
+
+    block_fields r;
+    fusionary::read(r, const_buffer(b.data(), size));
+    BOOST_CHECK(r.peer == f.peer);
+    BOOST_CHECK(r.native == f.native);
+    BOOST_CHECK(r.ordered == f.ordered);
+    BOOST_CHECK(r.samples == f.samples);
+
+    BOOST_CHECK_THROW(fusionary::read(r, const_buffer(b.data(), size - 1)),
+                      fusionary::buffer_overrun);
+
+    // Element counts over the uint16_t prefix are rejected, not truncated.
+    std::vector<uint8_t> large(256 * 1024);
+    f.samples.resize(65536);
+    BOOST_CHECK_THROW(fusionary::write(mutable_buffer(large.data(), large.size()), f),
+                      fusionary::value_overflow);
+}
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), view_packet,
+    (std::string_view, name)
+    (fusionary::span_view<big_uint16_t>, ports)
+    (fusionary::span_view<ordered_header>, headers)
+    (fusionary::rest_view, payload)
+);
+
+BOOST_AUTO_TEST_CASE(zero_copy_views)
+{
+    // Length prefixes are in host order, assume little-endian host.
+    std::array<uint8_t, 40> b{{3, 0, 'a', 'b', 'c',
+                               2, 0, 0x12, 0x34, 0x56, 0x78,
+                               2, 0, 7, 1, 2, 3, 4, 6, 5, 7, 8,
+                                     9, 0, 0, 0, 1, 1, 0, 0, 2,
+                               'p', 'a', 'y', 'l', 'o', 'a', 'd'}};
+    const_buffer in(b.data(), 38);
+
+    view_packet p;
+    fusionary::read(p, in);
+
+    BOOST_CHECK_EQUAL(p.name, "abc");
+    BOOST_CHECK(p.name.data() == reinterpret_cast<char const*>(b.data() + 2));
+    BOOST_REQUIRE_EQUAL(p.ports.size(), 2u);
+    BOOST_CHECK_EQUAL(p.ports[0], 0x1234);
+    BOOST_CHECK_EQUAL(p.ports[1], 0x5678);
+    BOOST_REQUIRE_EQUAL(p.headers.size(), 2u);
+    BOOST_CHECK_EQUAL(p.headers[0].length, 0x01020304u);
+    BOOST_CHECK_EQUAL(p.headers[1].type, 9);
+    BOOST_CHECK_EQUAL(p.headers[1].checksum.value(), 2);
+    BOOST_CHECK_EQUAL(p.payload.size(), 7u);
+    BOOST_CHECK(buffer_cast<void const*>(p.payload.data) == b.data() + 31);
+
+    uint32_t sum = 0;
+    for (auto port : p.ports) {
+        sum += port;
+    }
+    BOOST_CHECK_EQUAL(sum, 0x1234u + 0x5678u);
+
+    // Views are forwarded as is.
+    std::array<uint8_t, 40> out{};
+    auto rest = fusionary::write(mutable_buffer(out.data(), out.size()), p);
+    BOOST_CHECK_EQUAL(buffer_size(rest), 2u);
+    BOOST_CHECK(out == b);
+
+    BOOST_CHECK_EQUAL(fusionary::encoded_size<view_packet>(in), 38u);
+    BOOST_CHECK_THROW(fusionary::read(p, const_buffer(b.data(), 20)), fusionary::buffer_overrun);
+
+    // Views longer than the uint16_t prefix are rejected, not truncated.
+    std::vector<char> large(2 * 65536);
+    std::vector<uint8_t> large_out(256 * 1024);
+    view_packet big = p;
+    big.name = std::string_view(large.data(), 65536);
+    BOOST_CHECK_THROW(fusionary::write(mutable_buffer(large_out.data(), large_out.size()), big),
+                      fusionary::value_overflow);
+    big = p;
+    big.ports = fusionary::span_view<big_uint16_t>(large.data(), 65536);
+    BOOST_CHECK_THROW(fusionary::write(mutable_buffer(large_out.data(), large_out.size()), big),
+                      fusionary::value_overflow);
+}
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), gather_packet,
+    (fixed_header, header)
+    (std::string, name)
+    (std::string, note)
+    (fusionary::rest_view, payload)
+);
+
+BOOST_AUTO_TEST_CASE(gather_writer)
+{
+    std::vector<char> payload(64 * 1024);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = char(i * 7);
+    }
+
+    gather_packet p;
+    p.header.length = 0xabcd;
+    p.name = "short";
+    p.note = std::string(300, 'n');
+    p.payload.data = const_buffer(payload.data(), payload.size());
+
+    std::array<char, 64> header;
+    auto buffers = fusionary::gather_write(mutable_buffer(header.data(), header.size()), p);
+
+    // Header up to the note length, then the referenced note and payload.
+    BOOST_REQUIRE_EQUAL(buffers.size(), 3u);
+    BOOST_CHECK_EQUAL(buffer_size(buffers[0]), 12u + 2 + 5 + 2);
+    BOOST_CHECK(buffer_cast<char const*>(buffers[0]) == header.data());
+    BOOST_CHECK(buffer_cast<char const*>(buffers[1]) == p.note.data());
+    BOOST_CHECK(buffer_cast<char const*>(buffers[2]) == payload.data());
+
+    // Gathered output is identical to the contiguous one.
+    std::vector<char> flat(70 * 1024), gathered(buffer_size(buffers));
+    auto rest = fusionary::write(mutable_buffer(flat.data(), flat.size()), p);
+    flat.resize(flat.size() - buffer_size(rest));
+    buffer_copy(buffer(gathered), buffers);
+    BOOST_CHECK(flat == gathered);
+
+    BOOST_CHECK_THROW(fusionary::gather_write(mutable_buffer(header.data(), 16), p),
+                      fusionary::buffer_overrun);
+
+    // Referenced strings longer than the uint16_t prefix are rejected, not truncated.
+    p.note = std::string(65536, 'n');
+    BOOST_CHECK_THROW(fusionary::gather_write(mutable_buffer(header.data(), header.size()), p),
+                      fusionary::value_overflow);
+    p.note.resize(65535);
+    buffers = fusionary::gather_write(mutable_buffer(header.data(), header.size()), p);
+    BOOST_REQUIRE_EQUAL(buffers.size(), 3u);
+    BOOST_CHECK(std::memcmp(header.data() + 12 + 2 + 5, "\xff\xff", 2) == 0);
+    BOOST_CHECK_EQUAL(buffer_size(buffers[1]), 65535u);
+}
+
+using labels_t = std::unordered_map<std::string, uint8_t>;
+using varint_labels_t = fusionary::prefixed<fusionary::quic_varint, labels_t>;
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), varint_packet,
+    (fusionary::varint<uint32_t>, length)
+    (fusionary::zigzag<int16_t>, delta)
+    (fusionary::quic_varint, stream)
+    (fusionary::varint_string, name)
+    (fusionary::varint_vector<uint16_t>, ports)
+    (varint_labels_t, labels)
+);
+
+template <typename T>
+std::vector<uint8_t> encode(T const& val)
+{
+    std::vector<uint8_t> out(32);
+    auto rest = fusionary::write(mutable_buffer(out.data(), out.size()), val);
+    out.resize(out.size() - buffer_size(rest));
+    return out;
+}
+
+template <typename T>
+T decode(std::vector<uint8_t> const& in)
+{
+    T val;
+    auto rest = fusionary::read(val, const_buffer(in.data(), in.size()));
+    BOOST_CHECK_EQUAL(buffer_size(rest), 0u);
+    return val;
+}
+
+BOOST_AUTO_TEST_CASE(varints)
+{
+    using bytes = std::vector<uint8_t>;
+
+    BOOST_CHECK(encode(fusionary::varint<uint32_t>(0)) == bytes({0}));
+    BOOST_CHECK(encode(fusionary::varint<uint32_t>(127)) == bytes({0x7f}));
+    BOOST_CHECK(encode(fusionary::varint<uint32_t>(300)) == bytes({0xac, 0x02}));
+    BOOST_CHECK(encode(fusionary::varint<uint64_t>(~uint64_t(0)))
+                == bytes({0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01}));
+    BOOST_CHECK(encode(fusionary::zigzag<int32_t>(-1)) == bytes({0x01}));
+    BOOST_CHECK(encode(fusionary::zigzag<int32_t>(1)) == bytes({0x02}));
+    BOOST_CHECK(encode(fusionary::zigzag<int32_t>(-65)) == bytes({0x81, 0x01}));
+
+    // Examples from RFC 9000, appendix A.1.
+    BOOST_CHECK(encode(fusionary::quic_varint(37)) == bytes({0x25}));
+    BOOST_CHECK(encode(fusionary::quic_varint(15293)) == bytes({0x7b, 0xbd}));
+    BOOST_CHECK(encode(fusionary::quic_varint(494878333)) == bytes({0x9d, 0x7f, 0x3e, 0x7d}));
+    BOOST_CHECK(encode(fusionary::quic_varint(151288809941952652))
+                == bytes({0xc2, 0x19, 0x7c, 0x5e, 0xff, 0x14, 0xe8, 0x8c}));
+    BOOST_CHECK_EQUAL(decode<fusionary::quic_varint>({0x40, 0x25}), 37u);
+    BOOST_CHECK_THROW(encode(fusionary::quic_varint(fusionary::quic_varint::max + 1)),
+                      fusionary::value_overflow);
+
+    // Every length, both when decoded in the middle of a buffer and at its very end.
+    for (unsigned shift = 0; shift < 64; ++shift) {
+        uint64_t filler = shift ? (shift * 0x0101010101010101ull) >> (64 - shift) : 0;
+        uint64_t value = (uint64_t(1) << shift) | filler;
+        auto wire = encode(fusionary::varint<uint64_t>(value));
+        BOOST_CHECK_EQUAL(decode<fusionary::varint<uint64_t>>(wire), value);
+        auto padded = wire;
+        padded.resize(wire.size() + 8, 0xff);
+        fusionary::varint<uint64_t> v;
+        auto rest = fusionary::read(v, const_buffer(padded.data(), padded.size()));
+        BOOST_CHECK_EQUAL(v, value);
+        BOOST_CHECK_EQUAL(buffer_size(rest), 8u);
+
+        if (value <= fusionary::quic_varint::max) {
+            BOOST_CHECK_EQUAL(decode<fusionary::quic_varint>(encode(fusionary::quic_varint(value))),
+                              value);
+        }
+        int64_t negative = -static_cast<int64_t>(value >> 1);
+        BOOST_CHECK_EQUAL(decode<fusionary::zigzag<int64_t>>(encode(fusionary::zigzag<int64_t>(negative))),
+                          negative);
+    }
+
+    BOOST_CHECK_THROW(decode<fusionary::varint<uint8_t>>({0x80, 0x02}), fusionary::invalid_encoding);
+    BOOST_CHECK_THROW(decode<fusionary::zigzag<int8_t>>({0x80, 0x02}), fusionary::invalid_encoding);
+    BOOST_CHECK_THROW(decode<fusionary::varint<uint64_t>>(bytes(11, 0x80)),
+                      fusionary::invalid_encoding);
+    BOOST_CHECK_THROW(decode<fusionary::varint<uint32_t>>({0x80, 0x80}), fusionary::buffer_overrun);
+    BOOST_CHECK_THROW(decode<fusionary::quic_varint>({0x80, 0x01}), fusionary::buffer_overrun);
+}
+
+BOOST_AUTO_TEST_CASE(varint_length_prefixes)
+{
+    varint_packet p;
+    p.length = 1000;
+    p.delta = -3;
+    p.stream = 70000;
+    p.name = std::string("name");
+    p.ports = std::vector<uint16_t>{80, 443};
+    p.labels = labels_t{{"a", 1}};
+
+    std::array<uint8_t, 64> b{};
+    auto rest = fusionary::write(mutable_buffer(b.data(), b.size()), p);
+    size_t size = b.size() - buffer_size(rest);
+    BOOST_CHECK_EQUAL(size, 2 + 1 + 4 + 1 + 4 + 1 + 4 + 1 + 2 + 1 + 1);
+    BOOST_CHECK_EQUAL(fusionary::encoded_size<varint_packet>(const_buffer(b.data(), b.size())),
+                      size);
+
+    varint_packet r;
+    fusionary::read(r, const_buffer(b.data(), size));
+    BOOST_CHECK_EQUAL(r.length, 1000u);
+    BOOST_CHECK_EQUAL(r.delta, -3);
+    BOOST_CHECK_EQUAL(r.stream, 70000u);
+    BOOST_CHECK_EQUAL(r.name, "name");
+    BOOST_CHECK(r.ports == p.ports);
+    BOOST_CHECK(r.labels == p.labels);
+
+    // A huge length prefix must not be trusted.
+    std::array<uint8_t, 6> lying{{0xff, 0xff, 0xff, 0xff, 0x0f, 0}};
+    fusionary::varint_vector<uint16_t> ports;
+    BOOST_CHECK_THROW(fusionary::read(ports, const_buffer(lying.data(), lying.size())),
+                      fusionary::buffer_overrun);
+
+    // Large varint-prefixed containers are referenced by the gather writer.
+    p.name = std::string(70000, 'n');
+    p.ports = std::vector<uint16_t>(200, 8080);
+    std::array<char, 64> header;
+    auto buffers = fusionary::gather_write(mutable_buffer(header.data(), header.size()), p);
+    BOOST_REQUIRE_EQUAL(buffers.size(), 5u);
+    BOOST_CHECK(buffer_cast<char const*>(buffers[1]) == p.name.data());
+    BOOST_CHECK(buffer_cast<void const*>(buffers[3]) == p.ports.data());
+    BOOST_CHECK_EQUAL(buffer_size(buffers[3]), 400u);
+
+    std::vector<char> flat(80 * 1024), gathered(buffer_size(buffers));
+    rest = fusionary::write(mutable_buffer(flat.data(), flat.size()), p);
+    flat.resize(flat.size() - buffer_size(rest));
+    buffer_copy(buffer(gathered), buffers);
+    BOOST_CHECK(flat == gathered);
+}
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), rtp_header,
+    (fusionary::bits<2>, version)
+    (fusionary::bits<1>, padding)
+    (fusionary::bits<1>, extension)
+    (fusionary::bits<4>, csrc_count)
+    (fusionary::bits<1>, marker)
+    (fusionary::bits<7>, payload_type)
+    (fusionary::big<uint16_t>, sequence)
+    (fusionary::big<uint32_t>, timestamp)
+    (fusionary::bits<12>, left)
+    (fusionary::bits<12>, right)
+);
+
+using bit_optional_t = arsenal::optional_field_specification<uint16_t, field_index<1>, 2>;
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), bit_flags_packet,
+    (fusionary::bits<4>, kind)
+    (fusionary::bits<4>, flags)
+    (bit_optional_t, extra)
+    (std::string, name)
+);
+
+BOOST_AUTO_TEST_CASE(bit_fields)
+{
+    static_assert(fusionary::static_size<rtp_header> == 2 + 2 + 4 + 3);
+
+    rtp_header h;
+    h.version = 2;
+    h.padding = 0;
+    h.extension = 1;
+    h.csrc_count = 3;
+    h.marker = 1;
+    h.payload_type = 96;
+    h.sequence = 0x1234;
+    h.timestamp = 0xdeadbeef;
+    h.left = 0xabc;
+    h.right = 0x123;
+
+    std::array<uint8_t, 11> b{};
+    fusionary::write(mutable_buffer(b.data(), b.size()), h);
+    std::array<uint8_t, 11> expected{
+        {0x93, 0xe0, 0x12, 0x34, 0xde, 0xad, 0xbe, 0xef, 0xab, 0xc1, 0x23}};
+    BOOST_CHECK(b == expected);
+
+    rtp_header r;
+    fusionary::read(r, const_buffer(b.data(), b.size()));
+    BOOST_CHECK_EQUAL(r.version, 2);
+    BOOST_CHECK_EQUAL(r.padding, 0);
+    BOOST_CHECK_EQUAL(r.extension, 1);
+    BOOST_CHECK_EQUAL(r.csrc_count, 3);
+    BOOST_CHECK_EQUAL(r.marker, 1);
+    BOOST_CHECK_EQUAL(r.payload_type, 96);
+    BOOST_CHECK_EQUAL(r.sequence, 0x1234);
+    BOOST_CHECK_EQUAL(r.timestamp, 0xdeadbeefu);
+    BOOST_CHECK_EQUAL(r.left, 0xabc);
+    BOOST_CHECK_EQUAL(r.right, 0x123);
+
+    BOOST_CHECK_THROW(fusionary::read(r, const_buffer(b.data(), 10)), fusionary::buffer_overrun);
+    h.version = 4;
+    BOOST_CHECK_THROW(fusionary::write(mutable_buffer(b.data(), b.size()), h),
+                      fusionary::value_overflow);
+
+    // Bit fields can carry the flags of optional fields.
+    bit_flags_packet p;
+    p.kind = 9;
+    p.flags = 4;
+    p.extra = 0x0102;
+    p.name = "x";
+
+    std::array<uint8_t, 8> out{};
+    auto rest = fusionary::write(mutable_buffer(out.data(), out.size()), p);
+    BOOST_CHECK_EQUAL(buffer_size(rest), 2u);
+    BOOST_CHECK_EQUAL(out[0], 0x94);
+    BOOST_CHECK_EQUAL(fusionary::encoded_size<bit_flags_packet>(const_buffer(out.data(), 6)), 6u);
+
+    bit_flags_packet q;
+    fusionary::read(q, const_buffer(out.data(), 6));
+    BOOST_CHECK_EQUAL(q.kind, 9);
+    BOOST_REQUIRE(q.extra);
+    BOOST_CHECK_EQUAL(q.extra.get(), 0x0102);
+    BOOST_CHECK_EQUAL(q.name, "x");
+}
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), framed_body,
+    (uint8_t, type)
+    (std::string, payload)
+);
+
+using crc_body_t = fusionary::checksummed<framed_body>;
+using adler_ports_t = fusionary::checksummed<std::array<uint16_t, 2>, fusionary::adler32_sum>;
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), framed_packet,
+    (fusionary::big<uint16_t>, channel)
+    (crc_body_t, body)
+    (adler_ports_t, ports)
+);
+
+BOOST_AUTO_TEST_CASE(checksummed_fields)
+{
+    static_assert(fusionary::static_size<adler_ports_t> == 8);
+
+    framed_packet p;
+    p.channel = 7;
+    p.body.value.type = 1;
+    p.body.value.payload = "123456789";
+    p.ports.value = {{80, 443}};
+
+    std::array<uint8_t, 64> b{};
+    auto rest = fusionary::write(mutable_buffer(b.data(), b.size()), p);
+    size_t size = b.size() - buffer_size(rest);
+    BOOST_REQUIRE_EQUAL(size, 2 + 1 + 2 + 9 + 4 + 4 + 4);
+
+    // Checksum covers the encoded body only, stored big-endian right after it.
+    uint32_t crc = crc32c(b.data() + 2, 12);
+    std::array<uint8_t, 4> crc_bytes{
+        {uint8_t(crc >> 24), uint8_t(crc >> 16), uint8_t(crc >> 8), uint8_t(crc)}};
+    BOOST_CHECK(std::equal(crc_bytes.begin(), crc_bytes.end(), b.begin() + 14));
+
+    framed_packet r;
+    fusionary::read(r, const_buffer(b.data(), size));
+    BOOST_CHECK_EQUAL(r.channel, 7);
+    BOOST_CHECK_EQUAL(r.body.value.payload, "123456789");
+    BOOST_CHECK(r.ports.value == p.ports.value);
+    BOOST_CHECK_EQUAL(fusionary::encoded_size<framed_packet>(const_buffer(b.data(), b.size())),
+                      size);
+
+    for (size_t corrupt : {2, 10, 15, 19, 25}) {
+        auto damaged = b;
+        damaged[corrupt] ^= 0x20;
+        BOOST_CHECK_THROW(fusionary::read(r, const_buffer(damaged.data(), size)),
+                          fusionary::checksum_mismatch);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(overlay_views)
+{
+    std::array<uint8_t, 11> h{
+        {0x93, 0xe0, 0x12, 0x34, 0xde, 0xad, 0xbe, 0xef, 0xab, 0xc1, 0x23}};
+    fusionary::view<rtp_header> rtp(const_buffer(h.data(), h.size()));
+    BOOST_CHECK_EQUAL(rtp.get<7>(), 0xdeadbeefu);
+    BOOST_CHECK_EQUAL(rtp.get<5>().value, 96);
+    BOOST_CHECK_EQUAL(rtp.get<9>().value, 0x123);
+    BOOST_CHECK_EQUAL(rtp.size(), 11u);
+    BOOST_CHECK_THROW(fusionary::view<rtp_header>(const_buffer(h.data(), 10)),
+                      fusionary::buffer_overrun);
+
+    // Variable fields are found by skipping over the ones before them.
+    std::array<uint8_t, 38> b{{3, 0, 'a', 'b', 'c',
+                               2, 0, 0x12, 0x34, 0x56, 0x78,
+                               2, 0, 7, 1, 2, 3, 4, 6, 5, 7, 8,
+                                     9, 0, 0, 0, 1, 1, 0, 0, 2,
+                               'p', 'a', 'y', 'l', 'o', 'a', 'd'}};
+    fusionary::view<view_packet> v(const_buffer(b.data(), b.size()));
+    auto payload = v.get<3>();
+    BOOST_CHECK_EQUAL(payload.size(), 7u);
+    BOOST_CHECK(buffer_cast<void const*>(payload.data) == b.data() + 31);
+    BOOST_CHECK_EQUAL(v.get<1>()[1], 0x5678);
+    BOOST_CHECK_EQUAL(v.get<0>(), "abc");
+    BOOST_CHECK_EQUAL(buffer_size(v.field_data<2>()), 20u);
+    BOOST_CHECK_EQUAL(v.size(), 38u);
+
+    // Optional fields see the flags in the fixed prefix.
+    std::array<uint8_t, 6> o{{0x94, 0x02, 0x01, 1, 0, 'x'}};
+    fusionary::view<bit_flags_packet> f(const_buffer(o.data(), o.size()));
+    BOOST_CHECK_EQUAL(f.get<3>(), "x");
+    BOOST_REQUIRE(f.get<2>());
+    BOOST_CHECK_EQUAL(f.get<2>().get(), 0x0102);
+    BOOST_CHECK_EQUAL(f.get<0>().value, 9);
+
+    o[0] = 0x90;
+    fusionary::view<bit_flags_packet> g(const_buffer(o.data(), 4));
+    BOOST_CHECK(!g.get<2>());
+    BOOST_CHECK_THROW(g.get<3>(), fusionary::buffer_overrun);
+}
+
+using hello_tag_t = std::integral_constant<uint8_t, 1>;
+using bye_tag_t = std::integral_constant<uint8_t, 2>;
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), hello_message,
+    (hello_tag_t, tag)
+    (big_uint32_t, version)
+);
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), bye_message,
+    (bye_tag_t, tag)
+    (std::string, reason)
+);
+
+BOOST_AUTO_TEST_CASE(message_dispatch)
+{
+    using demux = fusionary::dispatcher<hello_message, bye_message, prefixed_packet>;
+    static_assert(demux::accepts(0xab) and !demux::accepts(3));
+
+    struct counting_handler
+    {
+        std::string seen;
+
+        void operator()(hello_message& m) { seen += "hello " + std::to_string(m.version) + ";"; }
+        void operator()(bye_message& m) { seen += "bye " + m.reason + ";"; }
+        void operator()(prefixed_packet& m) { seen += "packet " + m.name + ";"; }
+    } handler;
+
+    hello_message hello;
+    hello.version = 7;
+    bye_message bye;
+    bye.reason = "done";
+    prefixed_packet packet;
+    packet.name = "p";
+
+    std::array<char, 64> b;
+    auto out = fusionary::write(mutable_buffer(b.data(), b.size()), hello);
+    out = fusionary::write(out, packet);
+    out = fusionary::write(out, bye);
+    size_t size = b.size() - buffer_size(out);
+    const_buffer in(b.data(), size);
+
+    in = demux::dispatch(in, handler);
+    BOOST_CHECK_EQUAL(handler.seen, "hello 7;");
+    // Rest field takes the remainder of the buffer.
+    demux::dispatch(in, handler);
+    BOOST_CHECK_EQUAL(handler.seen, "hello 7;packet p;");
+    demux::dispatch(const_buffer(b.data() + size - 7, 7), handler);
+    BOOST_CHECK_EQUAL(handler.seen, "hello 7;packet p;bye done;");
+
+    // The fixed prefix past the marker is still bounds-checked.
+    BOOST_CHECK_THROW(demux::dispatch(const_buffer(b.data(), 4), handler),
+                      fusionary::buffer_overrun);
+
+    b[0] = 3;
+    BOOST_CHECK_THROW(demux::dispatch(const_buffer(b.data(), 5), handler),
+                      fusionary::invalid_encoding);
+    BOOST_CHECK_THROW(demux::dispatch(const_buffer(b.data(), 0), handler),
+                      fusionary::buffer_overrun);
+}
+
+using open_tag_t = std::integral_constant<uint16_t, 0x0100>;
+using close_tag_t = std::integral_constant<uint16_t, 0x8000>;
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), open_message,
+    (open_tag_t, tag)
+    (uint8_t, mode)
+);
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), close_message,
+    (close_tag_t, tag)
+    (std::string, reason)
+);
+
+BOOST_AUTO_TEST_CASE(sparse_message_dispatch)
+{
+    // Markers too far apart for a slot table are searched.
+    using demux = fusionary::dispatcher<open_message, close_message>;
+    static_assert(demux::accepts(0x8000) and !demux::accepts(0x0101));
+
+    std::string seen;
+    auto handler = [&](auto& m) {
+        if constexpr (std::is_same<std::decay_t<decltype(m)>, open_message>::value) {
+            seen += "open " + std::to_string(m.mode) + ";";
+        } else {
+            seen += "close " + m.reason + ";";
+        }
+    };
+
+    open_message open;
+    open.mode = 5;
+    close_message close;
+    close.reason = "eof";
+
+    std::array<char, 32> b;
+    auto out = fusionary::write(mutable_buffer(b.data(), b.size()), open);
+    out = fusionary::write(out, close);
+    const_buffer in(b.data(), b.size() - buffer_size(out));
+
+    in = demux::dispatch(in, handler);
+    in = demux::dispatch(in, handler);
+    BOOST_CHECK_EQUAL(buffer_size(in), 0u);
+    BOOST_CHECK_EQUAL(seen, "open 5;close eof;");
+
+    b[0] = 1;
+    BOOST_CHECK_THROW(demux::dispatch(const_buffer(b.data(), 3), handler),
+                      fusionary::invalid_encoding);
+}
+
+BOOST_AUTO_TEST_CASE(batch_columns)
+{
+    std::array<std::array<uint8_t, 16>, 3> slots{};
+    std::vector<const_buffer> packets;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        rtp_header h;
+        h.version = 2;
+        h.padding = 0;
+        h.extension = 0;
+        h.csrc_count = i;
+        h.marker = i & 1;
+        h.payload_type = 96 + i;
+        h.sequence = 1000 + i;
+        h.timestamp = 0x10000 * i;
+        h.left = 0xabc;
+        h.right = i;
+        fusionary::write(mutable_buffer(slots[i].data(), slots[i].size()), h);
+        packets.emplace_back(slots[i].data(), fusionary::static_size<rtp_header>);
+    }
+
+    fusionary::columns<rtp_header> cols;
+    static_assert(std::is_same<std::tuple_element_t<7, decltype(cols)>,
+                               std::vector<uint32_t>>::value);
+    BOOST_CHECK_EQUAL(fusionary::read_batch<rtp_header>(packets, cols), 3u);
+    BOOST_CHECK_EQUAL(fusionary::read_batch<rtp_header>(packets, cols), 3u);
+
+    BOOST_REQUIRE_EQUAL(std::get<6>(cols).size(), 6u);
+    for (size_t i = 0; i < 6; ++i) {
+        BOOST_CHECK_EQUAL(std::get<0>(cols)[i], 2);
+        BOOST_CHECK_EQUAL(std::get<3>(cols)[i], i % 3);
+        BOOST_CHECK_EQUAL(std::get<4>(cols)[i], i % 3 & 1);
+        BOOST_CHECK_EQUAL(std::get<5>(cols)[i], 96 + i % 3);
+        BOOST_CHECK_EQUAL(std::get<6>(cols)[i], 1000 + i % 3);
+        BOOST_CHECK_EQUAL(std::get<7>(cols)[i], 0x10000 * (i % 3));
+        BOOST_CHECK_EQUAL(std::get<8>(cols)[i], 0xabc);
+        BOOST_CHECK_EQUAL(std::get<9>(cols)[i], i % 3);
+    }
+
+    // Nothing is appended when one of the packets is short or has a wrong marker.
+    packets[1] = const_buffer(slots[1].data(), 10);
+    BOOST_CHECK_THROW(fusionary::read_batch<rtp_header>(packets, cols), fusionary::buffer_overrun);
+    BOOST_CHECK_EQUAL(std::get<9>(cols).size(), 6u);
+
+    std::array<uint8_t, 12> header{{0xab, 5, 0x12, 0x34, 0, 0, 0, 1, 0, 0, 0, 2}};
+    std::array<const_buffer, 2> headers{{const_buffer(header.data(), 12),
+                                         const_buffer(header.data(), 12)}};
+    fusionary::columns<fixed_header> header_cols;
+    fusionary::read_batch<fixed_header>(headers, header_cols);
+    BOOST_CHECK_EQUAL(std::get<1>(header_cols)[1].value, 5);
+    BOOST_CHECK_EQUAL(std::get<2>(header_cols)[1], 0x1234);
+    BOOST_CHECK_EQUAL(std::get<3>(header_cols)[0][1], 2u);
+
+    header[0] = 0xac;
+    BOOST_CHECK_THROW(fusionary::read_batch<fixed_header>(headers, header_cols),
+                      fusionary::invalid_encoding);
+    BOOST_CHECK_EQUAL(std::get<2>(header_cols).size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(packet_builder)
+{
+    fusionary::packet_builder pkt(64, 24);
+    pkt.append(std::string("data"));
+    char const* payload = buffer_cast<char const*>(pkt.data());
+
+    ordered_header inner;
+    inner.type = 1;
+    inner.length = 6;
+    inner.port = 80;
+    inner.checksum = 0;
+    pkt.prepend(inner);
+    pkt.prepend(std::string("outer"));
+    pkt.append(fusionary::big<uint16_t>(0xfeed));
+
+    BOOST_CHECK_EQUAL(pkt.size(), 7 + 9 + 6 + 2);
+    BOOST_CHECK_EQUAL(pkt.headroom(), 24u - 16);
+    BOOST_CHECK_EQUAL(pkt.tailroom(), 64u - 24 - 8);
+    // Payload stays where it was written.
+    BOOST_CHECK(buffer_cast<char const*>(pkt.data()) + 16 == payload);
+
+    std::string outer, data;
+    ordered_header r;
+    fusionary::big<uint16_t> trailer;
+    auto rest = fusionary::read(outer, pkt.data());
+    rest = fusionary::read(r, rest);
+    rest = fusionary::read(data, rest);
+    rest = fusionary::read(trailer, rest);
+    BOOST_CHECK_EQUAL(buffer_size(rest), 0u);
+    BOOST_CHECK_EQUAL(outer, "outer");
+    BOOST_CHECK_EQUAL(r.port, 80);
+    BOOST_CHECK_EQUAL(data, "data");
+    BOOST_CHECK_EQUAL(trailer, 0xfeed);
+
+    pkt.pull(7);
+    BOOST_CHECK_EQUAL(buffer_size(pkt.data()), 17u);
+    pkt.trim(9);
+    BOOST_CHECK_EQUAL(pkt.size(), 9u);
+
+    BOOST_CHECK_THROW(pkt.prepend(std::array<uint8_t, 20>{}), fusionary::buffer_overrun);
+    BOOST_CHECK_THROW(pkt.prepend(std::string(20, 'x')), fusionary::buffer_overrun);
+    BOOST_CHECK_THROW(pkt.put(41), fusionary::buffer_overrun);
+    BOOST_CHECK_EQUAL(pkt.size(), 9u);
+
+    // A header failing to encode half way leaves nothing behind.
+    rtp_header overflowing{};
+    overflowing.right = 0x1000;
+    std::string before(buffer_cast<char const*>(pkt.data()), pkt.size());
+    BOOST_CHECK_THROW(pkt.prepend(overflowing), fusionary::value_overflow);
+    BOOST_CHECK_EQUAL(pkt.size(), 9u);
+    BOOST_CHECK_EQUAL(pkt.headroom(), 24u - 16 + 7);
+    BOOST_CHECK(std::string(buffer_cast<char const*>(pkt.data()), pkt.size()) == before);
+
+    std::array<char, 16> storage;
+    fusionary::packet_builder small(mutable_buffer(storage.data(), storage.size()), 4);
+    small.append(uint32_t(7));
+    small.prepend(uint32_t(3));
+    BOOST_CHECK(buffer_cast<char const*>(small.data()) == storage.data());
+    BOOST_CHECK_THROW(small.prepend(uint8_t(1)), fusionary::buffer_overrun);
+}
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), telemetry_record,
+    (fusionary::big<uint32_t>, sequence)
+    (int16_t, temperature)
+    (fusionary::bits<4>, state)
+    (fusionary::bits<4>, mode)
+    (ids_t, ids)
+    (std::string, label)
+);
+
+BOOST_AUTO_TEST_CASE(delta_records)
+{
+    fusionary::delta_encoder<telemetry_record> encoder;
+    fusionary::delta_decoder<telemetry_record> decoder;
+    std::array<uint8_t, 64> b;
+
+    auto roundtrip = [&](telemetry_record const& rec) {
+        auto rest = encoder.write(mutable_buffer(b.data(), b.size()), rec);
+        size_t size = b.size() - buffer_size(rest);
+        BOOST_CHECK_EQUAL(buffer_size(decoder.read(const_buffer(b.data(), size))), 0u);
+        BOOST_CHECK(boost::fusion::equal_to(decoder.value(), rec));
+        return size;
+    };
+
+    telemetry_record rec;
+    rec.sequence = 0xfffffffe;
+    rec.temperature = 215;
+    rec.state = 3;
+    rec.mode = 0;
+    rec.ids = {{1, 2}};
+    rec.label = "probe";
+    // Key record: header, sequence (-2 modulo 2^32), temperature, state, ids and label.
+    BOOST_CHECK_EQUAL(roundtrip(rec), 1u + 1 + 2 + 1 + 8 + 7);
+
+    // Header and a one byte difference, also across the wraparound.
+    rec.sequence = rec.sequence + 1;
+    BOOST_CHECK_EQUAL(roundtrip(rec), 2u);
+    rec.sequence = rec.sequence + 1;
+    BOOST_CHECK_EQUAL(roundtrip(rec), 2u);
+    BOOST_CHECK_EQUAL(decoder.value().sequence, 0u);
+
+    rec.sequence = 1;
+    rec.temperature = -40;
+    rec.state = 0;
+    rec.mode = 15;
+    BOOST_CHECK_EQUAL(roundtrip(rec), 1u + 1 + 2 + 1 + 1);
+
+    // Nothing changed at all.
+    BOOST_CHECK_EQUAL(roundtrip(rec), 1u);
+
+    rec.label = "";
+    rec.ids = {{1, 3}};
+    BOOST_CHECK_EQUAL(roundtrip(rec), 1u + 8 + 2);
+
+    // A decoder joining late waits for a key record.
+    fusionary::delta_decoder<telemetry_record> late;
+    rec.sequence = 2;
+    auto rest = encoder.write(mutable_buffer(b.data(), b.size()), rec);
+    const_buffer record(b.data(), b.size() - buffer_size(rest));
+    decoder.read(record);
+    BOOST_CHECK_THROW(late.read(record), fusionary::invalid_encoding);
+    encoder.reset();
+    rec.sequence = 3;
+    rest = encoder.write(mutable_buffer(b.data(), b.size()), rec);
+    record = const_buffer(b.data(), b.size() - buffer_size(rest));
+    decoder.read(record);
+    late.read(record);
+    BOOST_CHECK(boost::fusion::equal_to(late.value(), rec));
+    BOOST_CHECK(boost::fusion::equal_to(decoder.value(), rec));
+
+    // Failed writes leave the stream where it was.
+    rec.label = std::string(100, 'x');
+    BOOST_CHECK_THROW(encoder.write(mutable_buffer(b.data(), b.size()), rec),
+                      fusionary::buffer_overrun);
+    rec.label = "";
+    rec.sequence = 4;
+    BOOST_CHECK_EQUAL(roundtrip(rec), 2u);
+}
+
+using varint_blob_t = fusionary::prefixed<fusionary::varint<uint32_t>, byte_array>;
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (), blob_packet,
+    (uint8_t, type)
+    (byte_array, key)
+    (varint_blob_t, payload)
+);
+
+BOOST_AUTO_TEST_CASE(byte_array_fields)
+{
+    blob_packet p;
+    p.type = 7;
+    p.key = byte_array("0123456789abcdef", 16);
+    p.payload = byte_array(std::string(300, 'p'));
+
+    std::array<char, 512> b;
+    auto rest = fusionary::write(mutable_buffer(b.data(), b.size()), p);
+    size_t size = b.size() - buffer_size(rest);
+    BOOST_CHECK_EQUAL(size, 1u + 2 + 16 + 2 + 300);
+    BOOST_CHECK_EQUAL(fusionary::encoded_size<blob_packet>(const_buffer(b.data(), size)), size);
+
+    // Decoded fields come from the arena their byte_arrays were constructed with.
+    std::array<char, 1024> arena_space;
+    std::pmr::monotonic_buffer_resource arena(arena_space.data(), arena_space.size(),
+                                              std::pmr::null_memory_resource());
+    // Assignment keeps the resource of the target, swapping hands the arena over.
+    blob_packet r;
+    byte_array key(&arena);
+    varint_blob_t payload{byte_array(&arena)};
+    swap(r.key, key);
+    swap(r.payload, payload);
+    fusionary::read(r, const_buffer(b.data(), size));
+    BOOST_CHECK_EQUAL(r.type, 7);
+    BOOST_CHECK(r.key == p.key);
+    BOOST_CHECK(r.payload == p.payload);
+    BOOST_CHECK(r.key.const_data() >= arena_space.data()
+        and r.key.const_data() < arena_space.data() + arena_space.size());
+    BOOST_CHECK(r.payload.get_allocator().resource() == &arena);
+
+    // Blobs over the threshold are referenced by the gather writer, not copied.
+    std::array<char, 512> header;
+    fusionary::gather_writer g(mutable_buffer(header.data(), header.size()), 16);
+    g(p);
+    auto const& buffers = g.buffers();
+    BOOST_REQUIRE_EQUAL(buffers.size(), 4u);
+    BOOST_CHECK(buffer_cast<char const*>(buffers[1]) == p.key.const_data());
+    BOOST_CHECK(buffer_cast<char const*>(buffers[3]) == p.payload.const_data());
+    BOOST_CHECK_EQUAL(buffer_size(buffers[3]), 300u);
+    BOOST_CHECK_EQUAL(buffer_size(buffers), size);
+
+    // Blobs longer than the uint16_t prefix are rejected, not truncated.
+    std::vector<char> large(80 * 1024);
+    p.key = byte_array(std::string(70000, 'k'));
+    BOOST_CHECK_THROW(fusionary::write(mutable_buffer(large.data(), large.size()), p),
+                      fusionary::value_overflow);
+}
@@ -0,0 +1,142 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE Test_mapped_file
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include "arsenal/mapped_file.h"
+#include "arsenal/byte_array.h"
+#include "arsenal/byte_array_wrap.h"
+#include "arsenal/flurry.h"
+
+using namespace std;
+using namespace arsenal;
+
+namespace {
+
+// File with the given contents, removed at the end of the test.
+struct temp_file
+{
+    string name;
+
+    temp_file(string const& contents)
+        : name(boost::unit_test::framework::current_test_case().p_name.get() + ".mapped.tmp")
+    {
+        ofstream out(name, ios::binary);
+        out << contents;
+    }
+
+    ~temp_file() { remove(name.c_str()); }
+
+    string contents() const
+    {
+        ifstream in(name, ios::binary);
+        return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+};
+
+// Spans several pages, so hints apply to partial ranges.
+string pattern()
+{
+    string s(3 * 4096 + 123, 0);
+    for (size_t i = 0; i < s.size(); ++i) {
+        s[i] = char(i * 7);
+    }
+    return s;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(map_read_only)
+{
+    temp_file file(pattern());
+    mapped_file map(file.name, mapped_file::mode::read_only,
+                    mapped_file::sequential | mapped_file::will_need | mapped_file::huge_pages);
+    BOOST_CHECK(!map.is_writable());
+    BOOST_CHECK_EQUAL(map.size(), pattern().size());
+    BOOST_CHECK(byte_view(map) == byte_view(pattern()));
+    BOOST_CHECK_EQUAL(boost::asio::buffer_size(map.as_buffer()), map.size());
+
+    map.advise(mapped_file::random, 5000, 100);
+    map.advise(mapped_file::normal, map.size() + 1);
+
+    mapped_file moved(std::move(map));
+    BOOST_CHECK(map.is_empty());
+    BOOST_CHECK(byte_view(moved) == byte_view(pattern()));
+}
+
+BOOST_AUTO_TEST_CASE(byte_array_from_read_only_mapping)
+{
+    temp_file file(pattern());
+    byte_array data(mapped_file(file.name));
+    BOOST_CHECK(data == byte_view(pattern()));
+
+    byte_array slice = data.mid(4096, 10);
+    BOOST_CHECK(slice.is_shared());
+    BOOST_CHECK(slice == byte_view(pattern()).mid(4096, 10));
+
+    // Writing never touches the read-only pages, even without other owners.
+    slice = byte_array();
+    char const* mapped = data.const_data();
+    data[0] = 'x';
+    BOOST_CHECK(data.const_data() != mapped);
+    BOOST_CHECK_EQUAL(data[0], 'x');
+    data.append('y');
+    BOOST_CHECK_EQUAL(data.size(), pattern().size() + 1);
+    BOOST_CHECK(file.contents() == pattern());
+}
+
+BOOST_AUTO_TEST_CASE(byte_array_from_copy_on_write_mapping)
+{
+    temp_file file(pattern());
+    byte_array data(mapped_file(file.name, mapped_file::mode::copy_on_write));
+
+    // Private pages are written in place, the file stays as it was.
+    char const* mapped = data.const_data();
+    data[0] = 'x';
+    BOOST_CHECK_EQUAL(data.const_data(), mapped);
+    BOOST_CHECK_EQUAL(data[0], 'x');
+    BOOST_CHECK(file.contents() == pattern());
+}
+
+BOOST_AUTO_TEST_CASE(read_archive_from_mapping)
+{
+    byte_array out;
+    {
+        byte_array_owrap<flurry::oarchive> write(out);
+        write.archive() << string("first") << byte_array(pattern()) << uint32_t(42);
+    }
+    temp_file file(out.as_string());
+
+    byte_array data(mapped_file(file.name, mapped_file::mode::read_only, mapped_file::sequential));
+    byte_array_iwrap<flurry::iarchive> read(data);
+    string first;
+    byte_array blob;
+    uint32_t last = 0;
+    read.archive() >> first >> blob >> last;
+    BOOST_CHECK_EQUAL(first, "first");
+    BOOST_CHECK(blob == byte_view(pattern()));
+    BOOST_CHECK_EQUAL(last, 42u);
+}
+
+BOOST_AUTO_TEST_CASE(empty_missing_and_special_files)
+{
+    temp_file file("");
+    mapped_file map(file.name);
+    BOOST_CHECK(map.is_empty());
+    BOOST_CHECK(byte_array(std::move(map)).is_empty());
+
+    BOOST_CHECK_THROW(mapped_file("no/such/file.bin"), system_error);
+    BOOST_CHECK_THROW(mapped_file("/proc/self/status"), system_error);
+    BOOST_CHECK_THROW(mapped_file("/dev/null"), system_error);
+    BOOST_CHECK_THROW(mapped_file("."), system_error);
+}
@@ -93,3 +93,42 @@ BOOST_AUTO_TEST_CASE(basic_reader)
     BOOST_CHECK(*packet.header5.version == 0x10203);
     BOOST_CHECK(packet.body.data == "Hello");
 }
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (actual), lazy_packet_type,
+    (actual::header_type, header1)
+    (lazy<actual::big_header_type>, header23)
+    (actual::header_type, header4)
+    (lazy<actual::header_type>, header5)
+    (rest_t, body)
+);
+
+BOOST_AUTO_TEST_CASE(lazy_reader)
+{
+    asio::const_buffer buf(buffer.data(), buffer.size());
+    actual::lazy_packet_type packet;
+
+    read(packet, buf);
+
+    BOOST_CHECK(packet.header1.packet_size.value.value() == 0xcdab);
+    BOOST_CHECK_EQUAL(packet.header23.size(), 10u);
+    BOOST_CHECK_EQUAL(packet.header5.size(), 9u);
+    BOOST_CHECK(packet.header4.packet_size.value.value() == 0x9a78563412efcdab);
+    BOOST_CHECK(packet.body.data == "Hello");
+
+    auto header23 = packet.header23.get();
+    BOOST_CHECK(*header23.version == 0x10203);
+    BOOST_CHECK(header23.packet_size2.value.value() == 0x12efcdab);
+    auto header5 = packet.header5.get();
+    BOOST_CHECK(header5.packet_size.value.value() == 0x1abcdef);
+    BOOST_CHECK(*header5.version == 0x10203);
+
+    // Lazy fields are written back verbatim.
+    std::array<uint8_t, 10> out;
+    write(asio::buffer(out), packet.header23);
+    BOOST_CHECK(std::equal(out.begin(), out.end(), buffer.begin() + 3));
+
+    BOOST_CHECK_EQUAL(encoded_size<actual::big_header_type>(asio::buffer(buffer.data() + 3, 10)), 10u);
+    BOOST_CHECK_THROW(encoded_size<actual::big_header_type>(asio::buffer(buffer.data() + 3, 9)),
+                      buffer_overrun);
+}
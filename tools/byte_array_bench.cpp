@@ -0,0 +1,171 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Micro-benchmarks for byte_array and friends.
+// Numbers are only meaningful in an optimized build (-DCMAKE_BUILD_TYPE=Release).
+//
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/format.hpp>
+#include "arsenal/byte_array.h"
+#include "arsenal/byte_search.h"
+#include "arsenal/hash_bytes.h"
+#include "arsenal/hash_combine.h"
+
+using namespace std;
+using namespace arsenal;
+
+//=================================================================================================
+// Harness
+//=================================================================================================
+
+namespace {
+
+volatile uint64_t sink; // Keeps results alive so the compiler can't drop the measured work.
+
+template <typename F>
+void bench(string const& name, size_t iterations, F&& f)
+{
+    f(); // warm up caches
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        f();
+    }
+    auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start);
+    cout << boost::format("%-48s %10.2f ns/iter") % name % (elapsed.count() / iterations) << endl;
+}
+
+} // anonymous namespace
+
+//=================================================================================================
+// Hashing
+//=================================================================================================
+
+namespace {
+
+// What std::hash<byte_array> used to do.
+size_t hash_per_byte(byte_view key)
+{
+    size_t seed = 0xdeadbeef;
+    for (auto x : key) {
+        stdext::hash_combine(seed, x);
+    }
+    return seed;
+}
+
+void bench_hashing()
+{
+    vector<char> data(4096);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = char(i * 31);
+    }
+
+    for (size_t size = 8; size <= 4096; size *= 2) {
+        string suffix = str(boost::format(", %d bytes") % size);
+        size_t iterations = 1 + (256 << 20) / (size + 64);
+        byte_view key(data.data(), size);
+
+        bench("hash_bytes" + suffix, iterations, [&] { sink = hash_bytes(key.data(), size); });
+        bench("std::hash<std::string_view>" + suffix, iterations, [&] {
+            sink = std::hash<std::string_view>()(std::string_view(key.data(), size));
+        });
+        if (size <= 256) {
+            bench("per-byte hash_combine" + suffix, iterations, [&] { sink = hash_per_byte(key); });
+        }
+    }
+}
+
+} // anonymous namespace
+
+//=================================================================================================
+// Searching
+//=================================================================================================
+
+namespace {
+
+// Text-like payload without any of the bytes searched for, the match sits at the very end.
+string make_haystack(size_t size, string const& tail)
+{
+    string text(size - tail.size(), ' ');
+    for (size_t i = 0; i < text.size(); ++i) {
+        text[i] = 'a' + (i * 7) % 26;
+    }
+    return text + tail;
+}
+
+void bench_searching()
+{
+    for (size_t size = 64; size <= 64 * 1024; size *= 8) {
+        string suffix = str(boost::format(", %d bytes") % size);
+        size_t iterations = 1 + (256 << 20) / (size + 64);
+
+        string delimiter = "\r\n\r\n";
+        string text = make_haystack(size, delimiter);
+        byte_view data(text);
+        bench("byte_view::find, 4 byte delimiter" + suffix, iterations, [&] {
+            sink = data.find(byte_view(delimiter));
+        });
+        bench("std::search, 4 byte delimiter" + suffix, iterations, [&] {
+            sink = std::search(data.begin(), data.end(), delimiter.begin(), delimiter.end())
+                - data.begin();
+        });
+        bench("std horspool searcher, 4 byte delimiter" + suffix, iterations, [&] {
+            boyer_moore_horspool_searcher<string::const_iterator> searcher(delimiter.begin(),
+                                                                           delimiter.end());
+            sink = std::search(data.begin(), data.end(), searcher) - data.begin();
+        });
+
+        string marker = "-----BEGIN SIGNATURE-----";
+        string marked = make_haystack(size, marker);
+        byte_view haystack(marked);
+        bench("byte_view::find, 25 byte marker" + suffix, iterations, [&] {
+            sink = haystack.find(byte_view(marker));
+        });
+        bench("std::search, 25 byte marker" + suffix, iterations, [&] {
+            sink = std::search(haystack.begin(), haystack.end(), marker.begin(), marker.end())
+                - haystack.begin();
+        });
+
+        string special = make_haystack(size, "<");
+        byte_view markup(special);
+        string set = "<>&\"'";
+        bench("byte_view::find_first_of, 5 byte set" + suffix, iterations, [&] {
+            sink = markup.find_first_of(byte_view(set));
+        });
+        bench("std::find_first_of, 5 byte set" + suffix, iterations, [&] {
+            sink = std::find_first_of(markup.begin(), markup.end(), set.begin(), set.end())
+                - markup.begin();
+        });
+
+        bench("byte_view::count" + suffix, iterations, [&] { sink = data.count('a'); });
+        bench("std::count" + suffix, iterations, [&] {
+            sink = std::count(data.begin(), data.end(), 'a');
+        });
+
+        string copy = text;
+        bench("constant_time_equal" + suffix, iterations, [&] {
+            sink = constant_time_equal(byte_view(text), byte_view(copy));
+        });
+        bench("memcmp" + suffix, iterations, [&] {
+            sink = memcmp(text.data(), copy.data(), size);
+        });
+    }
+}
+
+} // anonymous namespace
+
+int main()
+{
+    bench_hashing();
+    bench_searching();
+}
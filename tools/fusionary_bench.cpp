@@ -0,0 +1,351 @@
+//
+// Part of Metta OS. Check http://atta-metta.net for latest version.
+//
+// Copyright 2007 - 2014, Stanislav Karchebnyy <berkus@atta-metta.net>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Micro-benchmarks for fusionary readers and writers.
+// Numbers are only meaningful in an optimized build (-DCMAKE_BUILD_TYPE=Release).
+//
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <boost/format.hpp>
+#include "arsenal/fusionary.hpp"
+#include "arsenal/fusionary/batch.hpp"
+
+using namespace std;
+using namespace arsenal;
+namespace asio = boost::asio;
+
+//=================================================================================================
+// Harness
+//=================================================================================================
+
+namespace {
+
+volatile uint64_t sink; // Keeps results alive so the compiler can't drop the measured work.
+
+template <typename F>
+void bench(string const& name, size_t iterations, F&& f)
+{
+    f(); // warm up caches
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        f();
+    }
+    auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start);
+    cout << boost::format("%-48s %10.2f ns/iter") % name % (elapsed.count() / iterations) << endl;
+}
+
+// Same, reporting the throughput over bytes processed per iteration.
+template <typename F>
+void bench_bytes(string const& name, size_t bytes, F&& f)
+{
+    size_t iterations = 1 + (64 << 20) / bytes; // about 64 MB worth
+    f();
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        f();
+    }
+    auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start);
+    cout << boost::format("%-48s %10.2f GB/s") % name % (bytes * iterations / elapsed.count())
+         << endl;
+}
+
+} // anonymous namespace
+
+//=================================================================================================
+// Unaligned big-endian header decoding
+//=================================================================================================
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (bench), wire_header,
+    (uint8_t, type)
+    (fusionary::big<uint32_t>, length)
+    (fusionary::big<uint16_t>, channel)
+    (fusionary::big<uint64_t>, sequence)
+);
+
+namespace {
+
+constexpr size_t header_size = fusionary::static_size<bench::wire_header>;
+constexpr size_t packet_count = 1024;
+
+// Headers are packed back to back at odd offsets, none of them is aligned.
+vector<char> make_headers()
+{
+    vector<char> buf(packet_count * header_size + 1);
+    for (size_t i = 0; i < packet_count; ++i) {
+        bench::wire_header h;
+        h.type     = i & 0xff;
+        h.length   = i * 3;
+        h.channel  = i & 0xffff;
+        h.sequence = i * 1000;
+        fusionary::write(asio::buffer(buf.data() + 1 + i * header_size, header_size), h);
+    }
+    return buf;
+}
+
+void bench_endian_loads()
+{
+    auto buf = make_headers();
+    char const* base = buf.data() + 1;
+
+    bench("fusionary::read, unaligned big-endian header", 10000, [&] {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < packet_count; ++i) {
+            bench::wire_header h;
+            fusionary::read(h, asio::buffer(base + i * header_size, header_size));
+            sum += h.type + h.length + h.channel + h.sequence;
+        }
+        sink = sum;
+    });
+
+    // What hand-written parsers usually do: cast the pointer and swap the bytes.
+    // Misaligned access is undefined behaviour, but x86-64 tolerates it.
+    bench("raw pointer casts + bswap", 10000, [&] {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < packet_count; ++i) {
+            char const* p = base + i * header_size;
+            sum += *reinterpret_cast<uint8_t const*>(p)
+                + __builtin_bswap32(*reinterpret_cast<uint32_t const*>(p + 1))
+                + __builtin_bswap16(*reinterpret_cast<uint16_t const*>(p + 5))
+                + __builtin_bswap64(*reinterpret_cast<uint64_t const*>(p + 7));
+        }
+        sink = sum;
+    });
+}
+
+} // anonymous namespace
+
+//=================================================================================================
+// Varsize field dispatch
+//=================================================================================================
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (bench), eight_way,
+    (fusionary::nothing_t, none)
+    (uint8_t, u8)
+    (uint16_t, u16)
+    (uint32_t, u32)
+    (uint64_t, u64)
+    (fusionary::big<uint16_t>, b16)
+    (fusionary::big<uint32_t>, b32)
+    (fusionary::big<uint64_t>, b64)
+);
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (bench), sixteen_way,
+    (fusionary::nothing_t, none)
+    (uint8_t, u8)
+    (uint16_t, u16)
+    (uint32_t, u32)
+    (uint64_t, u64)
+    (fusionary::big<uint16_t>, b16)
+    (fusionary::big<uint32_t>, b32)
+    (fusionary::big<uint64_t>, b64)
+    (fusionary::little<uint16_t>, l16)
+    (fusionary::little<uint32_t>, l32)
+    (fusionary::little<uint64_t>, l64)
+    (int8_t, i8)
+    (int16_t, i16)
+    (int32_t, i32)
+    (int64_t, i64)
+    (fusionary::big<int32_t>, bi32)
+);
+
+namespace {
+
+// The textbook alternative: a table of one function per alternative, indexed by the flag.
+template <typename F, size_t... I>
+void table_dispatch(size_t index, F& f, std::index_sequence<I...>)
+{
+    using handler = void (*)(F&);
+    static constexpr handler table[] = {
+        [](F& fn) { fn(std::integral_constant<size_t, I>()); }...};
+    if (index < sizeof...(I)) {
+        table[index](f);
+    }
+}
+
+template <typename T, typename V>
+void read_through_table(varsize_field_wrapper<T, V>& w, fusionary::reader const& r, uint8_t value)
+{
+    auto read_one = [&](auto idx) {
+        auto& field = boost::fusion::at_c<decltype(idx)::value>(w.choice_);
+        r(field, &w.choice_);
+        w.output_ = field;
+    };
+    table_dispatch(value, read_one,
+                   std::make_index_sequence<boost::fusion::result_of::size<T>::value>());
+}
+
+// Packets of a flag byte followed by the alternative it selects, flags are pseudo-random.
+template <typename Mapping>
+vector<char> make_varsize_packets(size_t count)
+{
+    constexpr size_t ways = boost::fusion::result_of::size<Mapping>::value;
+    vector<char> buf(count * 9); // flag and the largest alternative
+    fusionary::writer w(asio::buffer(buf));
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < count; ++i) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t flag = (seed >> 16) % ways;
+        w(flag);
+        Mapping m;
+        fusionary::detail::dispatch_alternative<Mapping>(flag, [&](auto idx) {
+            auto& field = boost::fusion::at_c<decltype(idx)::value>(m);
+            if constexpr (!std::is_same<std::decay_t<decltype(field)>, fusionary::nothing_t>::value) {
+                field = i;
+                w(field);
+            }
+        });
+    }
+    buf.resize(buf.size() - asio::buffer_size(w.buf_));
+    return buf;
+}
+
+template <typename Mapping>
+void bench_varsize(string const& name)
+{
+    constexpr size_t count = 1 << 18; // too long a pattern for the branch predictor to learn
+    auto buf = make_varsize_packets<Mapping>(count);
+
+    bench(name + " varsize, read_fields", 30, [&] {
+        fusionary::reader r(asio::buffer(buf));
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t flag = r.fetch<uint8_t>();
+            varsize_field_wrapper<Mapping, uint64_t> w{};
+            fusionary::read_fields()(w, r, flag);
+            sum += w.output_;
+        }
+        sink = sum;
+    });
+
+    bench(name + " varsize, function pointer table", 30, [&] {
+        fusionary::reader r(asio::buffer(buf));
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t flag = r.fetch<uint8_t>();
+            varsize_field_wrapper<Mapping, uint64_t> w{};
+            read_through_table(w, r, flag);
+            sum += w.output_;
+        }
+        sink = sum;
+    });
+}
+
+} // anonymous namespace
+
+//=================================================================================================
+// Checksums
+//=================================================================================================
+
+BOOST_FUSION_DEFINE_STRUCT(
+    (bench), framed_body,
+    (fusionary::big<uint32_t>, sequence)
+    (fusionary::rest_view, payload)
+);
+
+namespace {
+
+using checksummed_body = fusionary::checksummed<bench::framed_body>;
+
+void bench_checksums()
+{
+    vector<char> data(64 * 1024 + 64);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = char(i * 31);
+    }
+    vector<char> out(data.size());
+
+    for (size_t size = 64; size <= 64 * 1024; size *= 4) {
+        string suffix = str(boost::format(", %d bytes") % size);
+
+        bench_bytes("crc32c" + suffix, size, [&] { sink = crc32c(data.data(), size); });
+        bench_bytes("adler32" + suffix, size, [&] { sink = adler32(data.data(), size); });
+        bench_bytes("fletcher16" + suffix, size, [&] { sink = fletcher16(data.data(), size); });
+
+        // Packet framed with a trailing CRC: written and checksummed in one go,
+        // against a plain write followed by a separate checksum pass.
+        checksummed_body framed;
+        framed.value.sequence = 1;
+        framed.value.payload.data = asio::buffer(data.data(), size - 8);
+        bench_bytes("write checksummed<> packet" + suffix, size, [&] {
+            fusionary::write(asio::buffer(out), framed);
+            sink = out[0];
+        });
+        bench_bytes("write packet, then crc32c" + suffix, size, [&] {
+            auto rest = fusionary::write(asio::buffer(out), framed.value);
+            size_t length = out.size() - asio::buffer_size(rest);
+            uint32_t crc = crc32c(out.data(), length);
+            fusionary::write(rest, fusionary::big<uint32_t>(crc));
+            sink = out[0];
+        });
+    }
+}
+
+} // anonymous namespace
+
+//=================================================================================================
+// Batch decoding
+//=================================================================================================
+
+namespace {
+
+// A recvmmsg() sized batch of headers, each in its own MTU-sized slot.
+void bench_batches()
+{
+    constexpr size_t batch = 64;
+    constexpr size_t slot  = 1500;
+    vector<char> slots(batch * slot);
+    vector<asio::const_buffer> packets;
+    for (size_t i = 0; i < batch; ++i) {
+        bench::wire_header h;
+        h.type     = i & 0xff;
+        h.length   = i * 3;
+        h.channel  = i & 0xffff;
+        h.sequence = i * 1000;
+        fusionary::write(asio::buffer(slots.data() + i * slot, slot), h);
+        packets.emplace_back(slots.data() + i * slot, 100 + i);
+    }
+
+    vector<bench::wire_header> headers(batch);
+    bench("fusionary::read per packet, 64 headers", 100000, [&] {
+        for (size_t i = 0; i < batch; ++i) {
+            fusionary::read(headers[i], packets[i]);
+        }
+        uint64_t sum = 0;
+        for (auto const& h : headers) {
+            sum += h.length + h.sequence;
+        }
+        sink = sum;
+    });
+
+    fusionary::columns<bench::wire_header> cols;
+    bench("fusionary::read_batch, 64 headers", 100000, [&] {
+        std::apply([](auto&... col) { (col.clear(), ...); }, cols);
+        fusionary::read_batch<bench::wire_header>(packets, cols);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < batch; ++i) {
+            sum += std::get<1>(cols)[i] + std::get<3>(cols)[i];
+        }
+        sink = sum;
+    });
+}
+
+} // anonymous namespace
+
+int main()
+{
+    bench_endian_loads();
+    bench_varsize<bench::eight_way>("8-way");
+    bench_varsize<bench::sixteen_way>("16-way");
+    bench_checksums();
+    bench_batches();
+}
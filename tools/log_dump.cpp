@@ -6,7 +6,8 @@
 // Distributed under the Boost Software License, Version 1.0.
 // (See file LICENSE_1_0.txt or a copy at http://www.boost.org/LICENSE_1_0.txt)
 //
-#include <fstream>
+#include <iostream>
+#include <system_error>
 #include <boost/program_options/parsers.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
@@ -15,6 +16,7 @@
 #include "arsenal/flurry.h"
 #include "arsenal/byte_array_wrap.h"
 #include "arsenal/hexdump.h"
+#include "arsenal/mapped_file.h"
 
 using namespace std;
 using namespace arsenal;
@@ -42,11 +44,18 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    byte_array data;
-    std::ifstream in(filename, std::ios::in|std::ios::binary);
-    flurry::iarchive ia(in);
+    // Dumps can be huge, read them straight from the page cache instead of copying.
+    byte_array file;
+    try {
+        file = mapped_file(filename, mapped_file::mode::read_only, mapped_file::sequential);
+    } catch (std::system_error const& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    byte_array_iwrap<flurry::iarchive> dump(file);
 
-    while (ia >> data) {
+    byte_array data;
+    while (dump.archive() >> data) {
         std::string what, stamp;
         byte_array blob;
         byte_array_iwrap<flurry::iarchive> read(data);